@@ -8,6 +8,8 @@
 #include "encoder.h"
 #include "commands.h"
 #include "display.h"
+#include "sampler.h"
+#include "burst.h"
 
 void setup() {
   Serial.begin(115200);
@@ -17,36 +19,38 @@ void setup() {
   printSystemStatus();
   
   // Initialize subsystems
-  initEncoder();
+  initEncoders();
+#if USE_SAMPLER_TASK
+  initBurst();
+  initSampler();
+#endif
 }
 
 void loop() {
+  // Handle serial commands
+  processSerialCommands();
+  
+#if USE_SAMPLER_TASK
+  // Telemetry: format whatever the acquisition task has queued
+  SampleRecord sample;
+  while (popSample(sample)) {
+    printEncoderData(sample);
+  }
+#else
   uint32_t currentTime = micros_fast();
   
   // Update encoder speed calculations
-  updateEncoderSpeed(currentTime);
-  
-  // Handle serial commands
-  processSerialCommands();
+  updateEncoderSpeeds(currentTime);
   
   // Check if it's time to output data
   static uint32_t lastOutput = 0;
   if ((uint32_t)(currentTime - lastOutput) >= SPEED_SAMPLE_US) {
-    // Get current readings
-    int64_t position = getPosition();
-    float rpm = getRPM();
-    float countsPerSec = emaCountsPerSec;
-    
-    // Check for index pulse
-    bool indexSeen;
-    noInterrupts();
-    indexSeen = indexFlag;
-    indexFlag = false;
-    interrupts();
-    
-    // Print encoder data
-    printEncoderData(position, rpm, countsPerSec, indexSeen);
+    for (EncoderBase* enc : encoders) {
+      // Current readings and index flag, then print
+      printEncoderData(enc->takeSample(currentTime));
+    }
     
     lastOutput = currentTime;
   }
+#endif
 }
@@ -0,0 +1,305 @@
+#include "bench.h"
+#include "encoder.h"
+#include "encoder_config.h"
+#include "trace_sim.h"
+
+// Same axis config, float vs Q16 blend path
+struct BenchFloatConfig : Axis0Config {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::AdaptiveBlend;
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 80000000;
+  static constexpr bool fixedPoint = false;
+};
+
+struct BenchFixedConfig : BenchFloatConfig {
+  static constexpr bool fixedPoint = true;
+};
+
+struct BenchAccelConfig : BenchFloatConfig {
+  static constexpr bool accelEstimate = true;
+};
+
+struct BenchRegressionConfig : BenchFloatConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::Regression;
+};
+
+struct BenchMTConfig : BenchFloatConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::MT;
+};
+
+struct BenchTrackingConfig : BenchFloatConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::Tracking;
+};
+
+static const uint32_t BENCH_ITERATIONS = 1000;
+
+// Average cycles per completed window, on a synthetic ~10k cps ramp
+template <typename Cfg>
+static uint32_t benchVelocityPipeline(float& result) {
+  VelocityPipeline<Cfg> pipeline;
+  EncoderSnapshot snap = {};
+  snap.deltaSign = 1;
+  uint32_t now = 0;
+  uint32_t totalCycles = 0;
+
+  pipeline.update(snap, now);  // Anchor the first window
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+    now += Cfg::sampleUs + (i & 3);  // Off-nominal windows too
+    snap.position += 100 + (i & 7);
+    snap.lastEdgeMicros = now;
+    snap.edgeDeltaTicks = 8000 - (i & 15);
+
+    uint32_t start = ESP.getCycleCount();
+    pipeline.update(snap, now);
+    totalCycles += ESP.getCycleCount() - start;
+  }
+  result = pipeline.countsPerSec();
+  return totalCycles / BENCH_ITERATIONS;
+}
+
+// Constant-acceleration ramp with quantized counts: RMS error of the
+// on-device acceleration vs differencing the reported cps per window,
+// which is what host-side post-processing of the stream does
+static const float ACCEL_BENCH_TRUE = 20000.0f;  // counts/s^2
+static const float ACCEL_BENCH_V0 = 2000.0f;     // counts/s
+static const uint32_t ACCEL_BENCH_WARMUP = 50;
+
+static void runAccelBench() {
+  VelocityPipeline<BenchAccelConfig> pipeline;
+  EncoderSnapshot snap = {};
+  snap.deltaSign = 1;
+  const float dt = BenchAccelConfig::sampleUs * 1e-6f;
+  uint32_t now = 0;
+  float prevCps = 0.0f;
+  double sqDevice = 0.0, sqDiff = 0.0;
+  uint32_t n = 0;
+
+  pipeline.update(snap, now);
+  for (uint32_t i = 1; i <= ACCEL_BENCH_WARMUP + BENCH_ITERATIONS; i++) {
+    now += BenchAccelConfig::sampleUs;
+    float t = i * dt;
+    float v = ACCEL_BENCH_V0 + ACCEL_BENCH_TRUE * t;
+    snap.position = (int64_t)floorf(ACCEL_BENCH_V0 * t + 0.5f * ACCEL_BENCH_TRUE * t * t);
+    snap.lastEdgeMicros = now;
+    snap.edgeDeltaTicks = (uint32_t)(BenchAccelConfig::edgeTickHz / v);
+    snap.deltaSign = 1;
+    pipeline.update(snap, now);
+
+    float cps = pipeline.countsPerSec();
+    if (i > ACCEL_BENCH_WARMUP) {
+      float devErr = pipeline.accelCountsPerSec2() - ACCEL_BENCH_TRUE;
+      float diffErr = (cps - prevCps) / dt - ACCEL_BENCH_TRUE;
+      sqDevice += devErr * devErr;
+      sqDiff += diffErr * diffErr;
+      n++;
+    }
+    prevCps = cps;
+  }
+
+  Serial.printf("BENCH accel noise (true %.0f counts/s^2): on-device rms=%.1f, cps differencing rms=%.1f\n",
+                ACCEL_BENCH_TRUE, sqrt(sqDevice / n), sqrt(sqDiff / n));
+}
+
+// Same ramp (trace_sim.h, bounds in test/test_position_prediction):
+// position predicted PREDICT_TRACE_AHEAD_US past each window from the last
+// edge, vs holding the last count (what Pos= gives)
+static void runPredictionBench() {
+  PredictionFigures fig = runPredictionTrace<BenchAccelConfig>();
+  Serial.printf("BENCH position +%uus: held count rms=%.3f, extrapolated rms=%.3f counts "
+                "(interpolated now rms=%.3f, before the last edge rms=%.3f)\n",
+                (unsigned)PREDICT_TRACE_AHEAD_US, fig.heldRms, fig.predictedRms, fig.nowRms,
+                fig.beforeRms);
+}
+
+// Accel/cruise/decel profile (trace_sim.h, bounds in test/test_tracking_profile)
+static void runProfileBench() {
+  ProfileFigures blend = runProfileTrace<BenchFloatConfig>();
+  ProfileFigures tracking = runProfileTrace<BenchTrackingConfig>();
+  Serial.printf("BENCH profile adaptive blend: ramp lag=%.2fms, cruise noise rms=%.3f%%\n",
+                blend.lagMs, blend.noisePct);
+  Serial.printf("BENCH profile tracking:       ramp lag=%.2fms, cruise noise rms=%.3f%%\n",
+                tracking.lagMs, tracking.noisePct);
+}
+
+// Constant speed trace (trace_sim.h, error bounds in test/test_speed_sweep)
+// through an EDGE_RING_SIZE ring: RMS error of each estimator and cycles
+// per edge drained. The top speeds overflow the ring.
+static const float EDGE_BENCH_SPEEDS[] = {20.0f, 200.0f, 2000.0f, 20000.0f, 50000.0f, 200000.0f};
+
+template <typename Cfg>
+static float benchEdgeEstimator(float cps, uint32_t& cyclesPerEdge, uint32_t& dropped) {
+  static EdgeRing<EDGE_RING_SIZE> ring;  // Off the loop task's stack
+  SpeedTraceResult r = runSpeedTrace<Cfg>(cps, ring, [] { return ESP.getCycleCount(); });
+  cyclesPerEdge = r.drained ? r.drainCycles / r.drained : 0;
+  dropped = r.dropped;
+  return r.rmsPct;
+}
+
+static void runEdgeEstimatorBench() {
+  for (float cps : EDGE_BENCH_SPEEDS) {
+    uint32_t blendCycles, regressionCycles, mtCycles, dropped;
+    float blendErr = benchEdgeEstimator<BenchFloatConfig>(cps, blendCycles, dropped);
+    float regressionErr = benchEdgeEstimator<BenchRegressionConfig>(cps, regressionCycles, dropped);
+    float mtErr = benchEdgeEstimator<BenchMTConfig>(cps, mtCycles, dropped);
+    Serial.printf("BENCH speed %6.0f cps: blend rms=%.3f%% (%u cyc/edge), "
+                  "regression rms=%.3f%% (%u cyc/edge), M/T rms=%.3f%% (%u cyc/edge), "
+                  "ring dropped %u\n",
+                  cps, blendErr, (unsigned)blendCycles, regressionErr,
+                  (unsigned)regressionCycles, mtErr, (unsigned)mtCycles, (unsigned)dropped);
+  }
+}
+
+// Filter bank trace (trace_sim.h, bounds in test/test_filter_bank) at the
+// default window rate
+struct FilterBenchCase {
+  VelocityFilterType type;
+  float param;
+};
+static const FilterBenchCase FILTER_BENCH_CASES[] = {
+    {VelocityFilterType::EMA, EMA_ALPHA},
+    {VelocityFilterType::MovingAverage, 8.0f},
+    {VelocityFilterType::SavitzkyGolay, 9.0f},
+    {VelocityFilterType::Butterworth, 10.0f},
+};
+
+static void runFilterBench() {
+  for (const FilterBenchCase& c : FILTER_BENCH_CASES) {
+    FilterFigures fig = runFilterTrace(c.type, c.param, SPEED_SAMPLE_US);
+    Serial.printf("BENCH filter %-3s %6.2f: step 10-90%%=%.0fms overshoot=%.1f%%, "
+                  "ramp lag=%.1fms, noise out/in=%.1f%%\n", VelocityFilter::name(c.type), c.param,
+                  fig.riseMs, fig.overshootPct, fig.rampLagMs, fig.noisePct);
+  }
+}
+
+void runVelocityBench() {
+  float floatCps, fixedCps;
+  uint32_t floatCycles = benchVelocityPipeline<BenchFloatConfig>(floatCps);
+  uint32_t fixedCycles = benchVelocityPipeline<BenchFixedConfig>(fixedCps);
+
+  Serial.printf("BENCH velocity float: %u cycles/window (cps=%.3f)\n", (unsigned)floatCycles, floatCps);
+  Serial.printf("BENCH velocity Q16:   %u cycles/window (cps=%.3f, diff=%.3f)\n",
+                (unsigned)fixedCycles, fixedCps, fixedCps - floatCps);
+  runAccelBench();
+  runPredictionBench();
+  runProfileBench();
+  runEdgeEstimatorBench();
+  runFilterBench();
+}
+
+#if !USE_HARDWARE_PCNT
+static const uint32_t ISR_BENCH_EDGES = 200;
+static const uint32_t ISR_BENCH_TIMEOUT_CYCLES = 240000;  // 1 ms at 240 MHz
+
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+static const char* const ISR_BACKEND_NAME = "dedic";
+#elif ISR_BACKEND == ISR_BACKEND_IDF
+static const char* const ISR_BACKEND_NAME = "idf";
+#else
+static const char* const ISR_BACKEND_NAME = "arduino";
+#endif
+
+// Cost of the A/B level read alone, averaged over back-to-back reads
+static const uint32_t READ_BENCH_ITERATIONS = 1000;
+static volatile uint32_t readBenchSink;
+
+static uint32_t benchGpioRegisterRead() {
+  uint32_t sink = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < READ_BENCH_ITERATIONS; i++) {
+    sink ^= GPIO.in;  // Peripheral bus read, as updateFromAB_Fast() does
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  readBenchSink = sink;
+  return cycles / READ_BENCH_ITERATIONS;
+}
+
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+static uint32_t benchDedicatedRead() {
+  uint32_t sink = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < READ_BENCH_ITERATIONS; i++) {
+    sink ^= dedic_gpio_cpu_ll_read_in();  // One CPU instruction
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  readBenchSink = sink;
+  return cycles / READ_BENCH_ITERATIONS;
+}
+#endif
+
+// Pull A low / release it and wait until the ISR has applied the count.
+// Returns the cycles from the register write to the count, 0 on timeout.
+static uint32_t benchEdge(const EncoderBase* enc, uint32_t pinMask, bool low) {
+  uint32_t before = enc->lastCountCycles();
+  uint32_t start = ESP.getCycleCount();
+  if (low) {
+    GPIO.out_w1tc = pinMask;
+  } else {
+    GPIO.out_w1ts = pinMask;
+  }
+  while (enc->lastCountCycles() == before) {
+    if (ESP.getCycleCount() - start > ISR_BENCH_TIMEOUT_CYCLES) return 0;
+  }
+  return enc->lastCountCycles() - start;
+}
+#endif
+
+void runIsrBench() {
+#if USE_HARDWARE_PCNT
+  Serial.println(F("BENCH isr: PCNT mode counts in hardware, nothing to measure"));
+#else
+  const EncoderBase* enc = encoders[0];
+  int pin = enc->pinAGpio();
+  if (pin >= 32) {
+    Serial.println(F("BENCH isr: pin A must be GPIO0-31"));
+    return;
+  }
+  uint32_t pinMask = 1UL << pin;
+
+  // Open drain only ever pulls low, so it can share the line with the
+  // encoder's open-collector output. The encoder must be standing still.
+  int64_t startPos = enc->getPosition();
+  GPIO.out_w1ts = pinMask;
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  delay(1);
+
+  // Latency: falling edges only, the rising ones also include the pull-up RC
+  uint32_t minLat = UINT32_MAX, maxLat = 0, sumLat = 0, timeouts = 0;
+  for (uint32_t i = 0; i < ISR_BENCH_EDGES; i++) {
+    uint32_t lat = benchEdge(enc, pinMask, true);
+    if (lat == 0) {
+      timeouts++;
+    } else {
+      if (lat < minLat) minLat = lat;
+      if (lat > maxLat) maxLat = lat;
+      sumLat += lat;
+    }
+    benchEdge(enc, pinMask, false);
+    delayMicroseconds(50);
+  }
+
+  // Rate: back-to-back edges, each one waited for; bounds the sustainable edge rate
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < ISR_BENCH_EDGES; i++) {
+    benchEdge(enc, pinMask, true);
+    benchEdge(enc, pinMask, false);
+  }
+  uint32_t rateCycles = ESP.getCycleCount() - start;
+
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT);
+
+  uint32_t measured = ISR_BENCH_EDGES - timeouts;
+  float cpuHz = ESP.getCpuFreqMHz() * 1e6f;
+  Serial.printf("BENCH isr backend=%s latency min=%u avg=%u max=%u cycles (timeouts=%u)\n",
+                ISR_BACKEND_NAME, (unsigned)(measured ? minLat : 0),
+                (unsigned)(measured ? sumLat / measured : 0), (unsigned)maxLat, (unsigned)timeouts);
+  Serial.printf("BENCH isr backend=%s maxEdgeRate=%.0f edges/s posDrift=%lld\n", ISR_BACKEND_NAME,
+                2.0f * ISR_BENCH_EDGES * cpuHz / (float)rateCycles,
+                (long long)(enc->getPosition() - startPos));
+
+  Serial.printf("BENCH isr read GPIO.in=%u cycles", (unsigned)benchGpioRegisterRead());
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+  Serial.printf(" dedicated=%u cycles", (unsigned)benchDedicatedRead());
+#endif
+  Serial.println();
+#endif
+}
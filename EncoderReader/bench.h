@@ -0,0 +1,11 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+// ====== ON-DEVICE BENCHMARKS ======
+// Cycle counts of the hot paths, measured with the CPU cycle counter
+void runVelocityBench();  // Also runs the acceleration noise bench
+void runIsrBench();  // ISR mode: edge-to-count latency and edge rate on axis 0
+
+#endif // BENCH_H
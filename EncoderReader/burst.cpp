@@ -0,0 +1,227 @@
+#include "burst.h"
+#include "encoder.h"
+#include "sampler.h"
+#include <esp_crc.h>
+#include "driver/gpio.h"
+
+#if USE_BURST_CAPTURE && USE_SAMPLER_TASK
+
+enum class BurstState : uint8_t { Idle, Armed, Triggered, Frozen };
+
+static const char* const BURST_STATE_NAMES[] = {"idle", "armed", "triggered", "frozen"};
+
+enum class BurstSource : uint8_t { None, Speed, IndexError, Gpio, Command };
+
+static const char* const BURST_SOURCE_NAMES[] = {"none", "speed", "index", "gpio", "command"};
+
+static const uint32_t BURST_PERIODS = BURST_SAMPLES / ENC_COUNT;  // Buffer length in periods
+
+static BurstRecord* burstBuffer = nullptr;
+
+// Set by the telemetry side while the task is not recording (Idle/Frozen)
+static uint32_t prePeriods = 0;
+static uint32_t postPeriods = 0;
+static float triggerCps = 0.0f;
+static volatile bool triggerRequested = false;
+
+// Owned by the sampling task while Armed/Triggered
+static volatile BurstState state = BurstState::Idle;
+static BurstSource source = BurstSource::None;
+static uint32_t writePeriod = 0;     // Periods recorded since arming
+static uint32_t triggerPeriod = 0;
+static uint32_t prevInvalid[ENC_COUNT];
+static uint32_t prevGlitches[ENC_COUNT];
+static uint32_t prevMismatches[ENC_COUNT];
+static uint32_t prevIndexCount[ENC_COUNT];
+
+static_assert(BURST_PERIODS >= 2, "BURST_SAMPLES too small for ENC_COUNT axes");
+
+void initBurst() {
+  burstBuffer = (BurstRecord*)ps_malloc(BURST_SAMPLES * sizeof(BurstRecord));
+  if (burstBuffer == nullptr) {
+    Serial.println(F("Burst: no PSRAM for the capture buffer, BURST disabled"));
+    return;
+  }
+#if BURST_TRIGGER_PIN >= 0
+  pinMode(BURST_TRIGGER_PIN, BURST_TRIGGER_LEVEL ? INPUT_PULLDOWN : INPUT_PULLUP);
+#endif
+  Serial.printf("Burst: %u records in PSRAM (%u periods of %d axes)\n", (unsigned)BURST_SAMPLES,
+                (unsigned)BURST_PERIODS, ENC_COUNT);
+}
+
+// Checked once per period, on the records just written
+static BurstSource checkTrigger(const BurstRecord* records) {
+  if (triggerRequested) {
+    triggerRequested = false;
+    return BurstSource::Command;
+  }
+  for (int i = 0; i < ENC_COUNT; i++) {
+    if (triggerCps > 0.0f && fabsf(records[i].countsPerSec) >= triggerCps) {
+      return BurstSource::Speed;
+    }
+#if BURST_TRIGGER_ON_INDEX_ERROR
+    if (records[i].flags & BURST_FLAG_INDEX_ERROR) return BurstSource::IndexError;
+#endif
+  }
+#if BURST_TRIGGER_PIN >= 0
+  if (gpio_get_level((gpio_num_t)BURST_TRIGGER_PIN) == BURST_TRIGGER_LEVEL) {
+    return BurstSource::Gpio;
+  }
+#endif
+  return BurstSource::None;
+}
+
+void burstRecord(uint32_t now) {
+  BurstState current = state;
+  if (current != BurstState::Armed && current != BurstState::Triggered) return;
+
+  BurstRecord* records = &burstBuffer[(writePeriod % BURST_PERIODS) * ENC_COUNT];
+  for (int i = 0; i < ENC_COUNT; i++) {
+    EncoderBase* enc = encoders[i];
+    EncoderDiagnostics diag = enc->diagnostics();
+    uint32_t indexCount = enc->indexLatch().count;
+
+    uint8_t flags = 0;
+    if (indexCount != prevIndexCount[i]) flags |= BURST_FLAG_INDEX;
+    if (diag.invalidTransitions != prevInvalid[i]) flags |= BURST_FLAG_INVALID;
+    if (diag.glitches != prevGlitches[i]) flags |= BURST_FLAG_GLITCH;
+    if (diag.indexMismatches != prevMismatches[i]) flags |= BURST_FLAG_INDEX_ERROR;
+    if (writePeriod == 0) flags = 0;  // The previous counters predate arming
+    prevIndexCount[i] = indexCount;
+    prevInvalid[i] = diag.invalidTransitions;
+    prevGlitches[i] = diag.glitches;
+    prevMismatches[i] = diag.indexMismatches;
+
+    BurstRecord& r = records[i];
+    r.timestamp = now;
+    r.position = (int32_t)enc->getPosition();
+    r.countsPerSec = enc->getCountsPerSec();
+    r.accel = enc->getAcceleration();
+    r.axis = enc->axis();
+    r.flags = flags;
+    r.reserved = 0;
+  }
+
+  if (current == BurstState::Armed && writePeriod >= prePeriods) {
+    source = checkTrigger(records);
+    if (source != BurstSource::None) {
+      for (int i = 0; i < ENC_COUNT; i++) records[i].flags |= BURST_FLAG_TRIGGER;
+      triggerPeriod = writePeriod;
+      state = BurstState::Triggered;
+    }
+  }
+  writePeriod++;
+  if (state == BurstState::Triggered && writePeriod > triggerPeriod + postPeriods) {
+    state = BurstState::Frozen;
+  }
+}
+
+bool armBurst(uint32_t preMs, uint32_t postMs, float speedCps) {
+  if (burstBuffer == nullptr) return false;
+  uint32_t periodUs, decimation;
+  getSamplerRates(periodUs, decimation);
+  uint32_t pre = (uint32_t)((uint64_t)preMs * 1000 / periodUs);
+  uint32_t post = (uint32_t)((uint64_t)postMs * 1000 / periodUs);
+  if (pre + post + 1 > BURST_PERIODS) return false;
+
+  state = BurstState::Idle;  // The task stops writing at its next period
+  delay(1 + periodUs / 1000);
+  prePeriods = pre;
+  postPeriods = post;
+  triggerCps = speedCps;
+  triggerRequested = false;
+  source = BurstSource::None;
+  writePeriod = 0;
+  triggerPeriod = 0;
+  __sync_synchronize();  // Publish the settings before the state
+  state = BurstState::Armed;
+  return true;
+}
+
+void triggerBurst() {
+  triggerRequested = true;
+}
+
+// Frozen window: the pre-trigger periods (fewer if the buffer had wrapped
+// less) up to the last post-trigger period
+static void frozenRange(uint32_t& firstPeriod, uint32_t& periods) {
+  uint32_t start = (triggerPeriod >= prePeriods) ? triggerPeriod - prePeriods : 0;
+  firstPeriod = start;
+  periods = writePeriod - start;
+}
+
+void printBurstStatus() {
+  if (burstBuffer == nullptr) {
+    Serial.println(F("Burst capture unavailable (no PSRAM)"));
+    return;
+  }
+  uint32_t periodUs, decimation;
+  getSamplerRates(periodUs, decimation);
+  Serial.printf("BURST %s source=%s recorded=%u pre=%u post=%u periods (%uus) speedTrig=%.0f\n",
+                BURST_STATE_NAMES[(int)state], BURST_SOURCE_NAMES[(int)source],
+                (unsigned)writePeriod, (unsigned)prePeriods, (unsigned)postPeriods,
+                (unsigned)periodUs, triggerCps);
+}
+
+void dumpBurst(int chunk) {
+  if (state != BurstState::Frozen) {
+    Serial.println(F("Nothing frozen (BURST ARM, then wait for a trigger)"));
+    return;
+  }
+  uint32_t firstPeriod, periods;
+  frozenRange(firstPeriod, periods);
+  uint32_t records = periods * ENC_COUNT;
+  uint32_t chunks = (records + BURST_CHUNK_RECORDS - 1) / BURST_CHUNK_RECORDS;
+  if (chunk >= (int)chunks) {
+    Serial.printf("Invalid chunk %d (0..%u)\n", chunk, (unsigned)(chunks - 1));
+    return;
+  }
+  uint32_t periodUs, decimation;
+  getSamplerRates(periodUs, decimation);
+  Serial.printf("BURST DUMP records=%u chunks=%u trigger=%u source=%s periodUs=%u axes=%d\n",
+                (unsigned)records, (unsigned)chunks,
+                (unsigned)((triggerPeriod - firstPeriod) * ENC_COUNT),
+                BURST_SOURCE_NAMES[(int)source], (unsigned)periodUs, ENC_COUNT);
+
+  uint32_t from = (chunk < 0) ? 0 : chunk;
+  uint32_t to = (chunk < 0) ? chunks : chunk + 1;
+  for (uint32_t c = from; c < to; c++) {
+    uint32_t begin = c * BURST_CHUNK_RECORDS;
+    uint16_t count = (records - begin < BURST_CHUNK_RECORDS) ? records - begin : BURST_CHUNK_RECORDS;
+    uint8_t header[4] = {(uint8_t)c, (uint8_t)(c >> 8), (uint8_t)count, (uint8_t)(count >> 8)};
+    Serial.write(header, sizeof(header));
+
+    uint32_t crc = 0;
+    for (uint32_t k = begin; k < begin + count; k++) {
+      // Record k of the frozen window, wherever it sits in the ring
+      uint32_t period = firstPeriod + k / ENC_COUNT;
+      const BurstRecord& r = burstBuffer[(period % BURST_PERIODS) * ENC_COUNT + k % ENC_COUNT];
+      crc = esp_crc32_le(crc, (const uint8_t*)&r, sizeof(r));
+      Serial.write((const uint8_t*)&r, sizeof(r));
+    }
+    uint8_t trailer[4] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16),
+                          (uint8_t)(crc >> 24)};
+    Serial.write(trailer, sizeof(trailer));
+  }
+  Serial.println();
+  Serial.println(F("BURST END"));
+}
+
+#else
+
+void initBurst() {}
+void burstRecord(uint32_t /*now*/) {}
+
+static void burstDisabled() {
+  Serial.println(F("Burst capture disabled (needs USE_BURST_CAPTURE and USE_SAMPLER_TASK)"));
+}
+
+bool armBurst(uint32_t /*preMs*/, uint32_t /*postMs*/, float /*speedCps*/) {
+  burstDisabled();
+  return false;
+}
+void triggerBurst() { burstDisabled(); }
+void printBurstStatus() { burstDisabled(); }
+void dumpBurst(int /*chunk*/) { burstDisabled(); }
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef BURST_H
+#define BURST_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ====== TRIGGERED BURST CAPTURE ======
+// The sampling task records every estimation period (RATE, up to 10 kHz),
+// one record per axis, into a circular buffer in PSRAM. Once armed it
+// runs until a trigger, keeps recording for the post-trigger time and
+// freezes, holding the pre- and post-trigger history. Triggers: speed
+// above a threshold on any axis, a Z miscount (BURST_TRIGGER_ON_INDEX_ERROR),
+// a level on BURST_TRIGGER_PIN, or the BURST TRIGGER command; triggers are
+// only checked once the pre-trigger history is full. The frozen
+// buffer goes out in CRC-checked binary chunks, so a slow link only
+// delays the transfer.
+//
+// BURST DUMP [chunk] format, after a text line
+//   "BURST DUMP records=<n> chunks=<c> trigger=<record> source=<s> periodUs=<p> axes=<a>":
+//   per chunk: u16 chunk index, u16 record count, the records, then the u32
+//   CRC-32 (esp_crc32_le) of the records; all little endian. "BURST END" follows.
+//   Records are BurstRecord below, oldest first, axes interleaved per period.
+
+struct BurstRecord {
+  uint32_t timestamp;  // esp_timer µs of the sampling period
+  int32_t position;    // Low 32 bits of the reported position
+  float countsPerSec;
+  float accel;         // counts/s^2 (0 unless ESTIMATE_ACCEL)
+  uint8_t axis;
+  uint8_t flags;       // BURST_FLAG_*
+  uint16_t reserved;
+};
+static_assert(sizeof(BurstRecord) == 20, "BurstRecord is a wire format");
+
+enum : uint8_t {
+  BURST_FLAG_INDEX = 0x01,          // Z edge during this period
+  BURST_FLAG_INVALID = 0x02,        // Invalid AB transition(s) during this period
+  BURST_FLAG_GLITCH = 0x04,         // Rejected glitch(es) during this period
+  BURST_FLAG_INDEX_ERROR = 0x08,    // Z-to-Z miscount at this period's Z
+  BURST_FLAG_TRIGGER = 0x80,        // The period the trigger fired in
+};
+
+void initBurst();
+void burstRecord(uint32_t now);  // Sampling task, after updateEncoderSpeeds()
+
+// Telemetry side: arming clears the buffer; speedCps <= 0 disables the
+// speed trigger
+bool armBurst(uint32_t preMs, uint32_t postMs, float speedCps);
+void triggerBurst();
+void printBurstStatus();
+void dumpBurst(int chunk);  // chunk < 0 = all chunks
+
+#endif // BURST_H
@@ -0,0 +1,227 @@
+#include "capture.h"
+#include "encoder.h"
+#include "sampler.h"
+
+#if USE_RMT_CAPTURE
+#include "driver/rmt.h"
+
+// The S3's RMT receive channels are 4..7
+static const rmt_channel_t CAPTURE_CHANNELS[2] = {RMT_CHANNEL_4, RMT_CHANNEL_5};
+static const char CAPTURE_NAMES[2] = {'A', 'B'};
+static const uint16_t CAPTURE_IDLE_TICKS = 0x7FFF;  // Longest level an item can hold
+static const uint32_t CAPTURE_TICK_HZ = 80000000 / CAPTURE_RMT_CLK_DIV;  // APB = 80 MHz
+static const uint8_t EDGE_TRACE_CHANNEL = 2;
+
+static RingbufHandle_t captureRings[2] = {nullptr, nullptr};
+static bool captureInstalled = false;
+static bool captureRunning = false;
+static uint32_t captureStartMicros = 0;
+
+// Edge trace: written by the sampler (recordEdgeTrace) only while running
+volatile bool edgeTraceRunning = false;
+static EdgeEvent* edgeTrace = nullptr;  // Allocated like the RMT rings, START to dump
+static volatile uint32_t edgeTraceCount = 0;
+static volatile uint32_t edgeTraceFull = 0;  // Edges that did not fit
+static uint32_t edgeTraceStartOverflows = 0;
+
+static_assert(CAPTURE_AXIS < ENC_COUNT, "CAPTURE_AXIS must be an enabled axis");
+static_assert(CAPTURE_RMT_CLK_DIV >= 1 && CAPTURE_RMT_CLK_DIV <= 255, "RMT divider is 8 bits");
+static_assert(CAPTURE_BUFFER_BYTES / 4 <= 0xFFFF, "A dump block counts items in 16 bits");
+static_assert(CAPTURE_EDGE_EVENTS > 0 && CAPTURE_EDGE_EVENTS <= 0xFFFF,
+              "The edge trace is one dump block (16-bit count)");
+
+void recordEdgeTrace(const EdgeEvent& e) {
+  uint32_t n = edgeTraceCount;
+  if (n >= CAPTURE_EDGE_EVENTS) {
+    edgeTraceFull = edgeTraceFull + 1;
+    return;
+  }
+  edgeTrace[n] = e;
+  edgeTraceCount = n + 1;
+}
+
+// The sampler may be inside recordEdgeTrace() when the flag drops; after
+// one more period it no longer touches the trace
+static void waitSamplerPeriod() {
+  uint32_t periodUs, decimation;
+  getSamplerRates(periodUs, decimation);
+  delay(1 + periodUs / 1000);
+}
+
+static uint32_t edgesLost() {
+  return encoders[CAPTURE_AXIS]->edgeRingOverflows() - edgeTraceStartOverflows + edgeTraceFull;
+}
+
+// Leaves nothing installed on failure
+static esp_err_t installChannel(int i, int pin) {
+  // Routing the pad to the RMT too leaves the PCNT/GPIO input untouched
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)pin, CAPTURE_CHANNELS[i]);
+  config.clk_div = CAPTURE_RMT_CLK_DIV;
+  config.mem_block_num = 1;
+  config.rx_config.idle_threshold = CAPTURE_IDLE_TICKS;
+  config.rx_config.filter_en = CAPTURE_FILTER_CYCLES > 0;
+  config.rx_config.filter_ticks_thresh = CAPTURE_FILTER_CYCLES;
+  esp_err_t err = rmt_config(&config);
+  if (err != ESP_OK) return err;
+  err = rmt_driver_install(CAPTURE_CHANNELS[i], CAPTURE_BUFFER_BYTES, 0);
+  if (err != ESP_OK) return err;
+  // Ping-pong the channel memory so a frame may be longer than one block
+  err = rmt_set_rx_thr_intr_en(CAPTURE_CHANNELS[i], true, 24);
+  if (err == ESP_OK) err = rmt_get_ringbuf_handle(CAPTURE_CHANNELS[i], &captureRings[i]);
+  if (err != ESP_OK) {
+    rmt_driver_uninstall(CAPTURE_CHANNELS[i]);
+    captureRings[i] = nullptr;
+  }
+  return err;
+}
+
+static bool installCapture() {
+  const EncoderBase* enc = encoders[CAPTURE_AXIS];
+  const int pins[2] = {enc->pinAGpio(), enc->pinBGpio()};
+
+  for (int i = 0; i < 2; i++) {
+    esp_err_t err = installChannel(i, pins[i]);
+    if (err != ESP_OK) {
+      Serial.printf("Capture not started: RMT channel %c: %s\n", CAPTURE_NAMES[i],
+                    esp_err_to_name(err));
+      while (i-- > 0) {
+        rmt_driver_uninstall(CAPTURE_CHANNELS[i]);
+        captureRings[i] = nullptr;
+      }
+      return false;
+    }
+  }
+  edgeTrace = (EdgeEvent*)malloc(CAPTURE_EDGE_EVENTS * sizeof(EdgeEvent));
+  captureInstalled = true;
+  return true;
+}
+
+static void uninstallCapture() {
+  for (int i = 0; i < 2; i++) {
+    rmt_driver_uninstall(CAPTURE_CHANNELS[i]);
+    captureRings[i] = nullptr;
+  }
+  free(edgeTrace);
+  edgeTrace = nullptr;
+  captureInstalled = false;
+}
+
+void startCapture() {
+  stopCapture();
+  if (captureInstalled) uninstallCapture();  // Fresh, empty rings
+  if (!installCapture()) return;
+  captureStartMicros = micros_fast();
+  edgeTraceCount = 0;
+  edgeTraceFull = 0;
+  edgeTraceStartOverflows = encoders[CAPTURE_AXIS]->edgeRingOverflows();
+  rmt_rx_start(CAPTURE_CHANNELS[0], true);
+  rmt_rx_start(CAPTURE_CHANNELS[1], true);
+  __sync_synchronize();  // Publish the empty trace before the flag
+  edgeTraceRunning = edgeTrace != nullptr;
+  captureRunning = true;
+  Serial.printf("Capture started: axis %d A/B, %u ticks/s, %d bytes per channel, %s\n",
+                CAPTURE_AXIS, (unsigned)CAPTURE_TICK_HZ, CAPTURE_BUFFER_BYTES,
+                edgeTraceRunning ? "edge trace on" : "no memory for the edge trace");
+}
+
+void stopCapture() {
+  if (!captureRunning) return;
+  rmt_rx_stop(CAPTURE_CHANNELS[0]);
+  rmt_rx_stop(CAPTURE_CHANNELS[1]);
+  if (edgeTraceRunning) {
+    edgeTraceRunning = false;
+    waitSamplerPeriod();
+  }
+  captureRunning = false;
+}
+
+void printCaptureStatus() {
+  if (!captureInstalled) {
+    Serial.println(F("CAPTURE idle (CAPTURE START to record)"));
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    size_t freeBytes = xRingbufferGetCurFreeSize(captureRings[i]);
+    Serial.printf("CAPTURE ch=%c %s used=%u/%d bytes\n", CAPTURE_NAMES[i],
+                  captureRunning ? "running" : "stopped",
+                  (unsigned)(CAPTURE_BUFFER_BYTES - freeBytes), CAPTURE_BUFFER_BYTES);
+  }
+  Serial.printf("CAPTURE edges=%u/%d lost=%u\n", (unsigned)edgeTraceCount, CAPTURE_EDGE_EVENTS,
+                (unsigned)edgesLost());
+}
+
+static void writeU16(uint16_t value) {
+  uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+  Serial.write(bytes, sizeof(bytes));
+}
+
+static void writeU32(uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16),
+                      (uint8_t)(value >> 24)};
+  Serial.write(bytes, sizeof(bytes));
+}
+
+void dumpCapture() {
+  if (!captureInstalled) {
+    Serial.println(F("Nothing captured (CAPTURE START first)"));
+    return;
+  }
+  stopCapture();
+  Serial.println(F("CAPTURE DUMP"));
+  Serial.write((const uint8_t*)"ENCR", 4);
+  Serial.write((uint8_t)2);
+  Serial.write((uint8_t)CAPTURE_AXIS);
+  writeU16(0);
+  writeU32(CAPTURE_TICK_HZ);
+  writeU32(encoders[CAPTURE_AXIS]->edgeTickHz());
+  writeU32(captureStartMicros);
+  writeU32(edgesLost());
+
+  for (int i = 0; i < 2; i++) {
+    size_t size;
+    rmt_item32_t* items;
+    while ((items = (rmt_item32_t*)xRingbufferReceive(captureRings[i], &size, 0)) != nullptr) {
+      uint16_t count = size / sizeof(rmt_item32_t);
+      Serial.write((uint8_t)i);
+      Serial.write((uint8_t)0);
+      writeU16(count);
+      for (uint16_t k = 0; k < count; k++) {
+        writeU32(items[k].val);
+      }
+      vRingbufferReturnItem(captureRings[i], items);
+    }
+  }
+
+  uint16_t edges = (uint16_t)edgeTraceCount;
+  Serial.write(EDGE_TRACE_CHANNEL);
+  Serial.write((uint8_t)0);
+  writeU16(edges);
+  for (uint16_t k = 0; k < edges; k++) {
+    const EdgeEvent& e = edgeTrace[k];
+    writeU32(e.ticks);
+    Serial.write(e.stateAB);
+    Serial.write((uint8_t)e.delta);
+    Serial.write((uint8_t)(e.glitch ? 1 : 0));
+    Serial.write((uint8_t)0);
+  }
+
+  Serial.write((uint8_t)0xFF);
+  Serial.write((uint8_t)0);
+  writeU16(0);
+  Serial.println();
+  Serial.println(F("CAPTURE END"));
+  uninstallCapture();
+}
+
+#else
+
+static void captureDisabled() {
+  Serial.println(F("RMT capture disabled (USE_RMT_CAPTURE=0)"));
+}
+
+void startCapture() { captureDisabled(); }
+void stopCapture() {}
+void printCaptureStatus() { captureDisabled(); }
+void dumpCapture() { captureDisabled(); }
+
+#endif
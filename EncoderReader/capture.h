@@ -0,0 +1,57 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "edge_ring.h"
+
+// ====== RMT RAW EDGE CAPTURE ======
+// Records the A and B edge trains of CAPTURE_AXIS with two RMT receive
+// channels: the hardware stores each level and its duration (1 tick =
+// CAPTURE_RMT_CLK_DIV APB cycles), so no CPU time is spent per edge and
+// bounces shorter than any ISR could see are kept. The driver moves the
+// items into a RAM ring of CAPTURE_BUFFER_BYTES per channel until it is
+// full; counting and telemetry keep running meanwhile. The RMT driver (and
+// its buffers) is only installed from CAPTURE START until the dump.
+//
+// A level longer than 32767 ticks ends an RMT frame; the length of the gap
+// that follows is not recorded. The two channels have no common timebase
+// (each frame starts at its own first edge), so the RMT items give per
+// channel detail (duty cycle, bounce) but not the A/B phase.
+//
+// For the phase, the edge events the sampler drains from the axis' edge
+// ring are recorded alongside (CAPTURE_EDGE_EVENTS of them): every A and B
+// edge with the AB state after it, on the encoder edge clock. That is the
+// MCPWM capture timer (80 MHz, PCNT mode axes 0-1) or esp_timer (1 MHz,
+// ISR mode); axes without edge timing record none. Edges the ring dropped
+// or that did not fit are counted as lost.
+//
+// CAPTURE DUMP format (little endian), after a "CAPTURE DUMP" text line:
+//   header: "ENCR", u8 version (2), u8 axis, u16 0, u32 RMT ticks per second,
+//           u32 edge ticks per second, u32 start µs, u32 edges lost
+//   blocks: u8 channel (0 = A, 1 = B), u8 0, u16 item count, then that many
+//           u32 RMT items (bits 0-14 duration0, 15 level0, 16-30 duration1,
+//           31 level1; a zero duration ends the frame)
+//   edges:  u8 channel 2, u8 0, u16 event count, then that many 8-byte
+//           events: u32 edge ticks, u8 AB state (A = bit 1), i8 count delta,
+//           u8 flags (bit 0 = rejected bounce), u8 0
+//   end:    a block with channel 0xFF and count 0, then "\nCAPTURE END"
+// Each block of an RMT channel is one received frame, in order.
+
+void startCapture();  // Discards any previous capture
+void stopCapture();
+void printCaptureStatus();
+void dumpCapture();  // Stops the capture and streams everything recorded
+
+#if USE_RMT_CAPTURE
+extern volatile bool edgeTraceRunning;
+void recordEdgeTrace(const EdgeEvent& e);
+// Sampler side: each edge drained from CAPTURE_AXIS while a capture runs
+inline void captureEdgeEvent(const EdgeEvent& e) {
+  if (edgeTraceRunning) recordEdgeTrace(e);
+}
+#else
+inline void captureEdgeEvent(const EdgeEvent&) {}
+#endif
+
+#endif // CAPTURE_H
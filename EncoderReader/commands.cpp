@@ -1,20 +1,254 @@
 #include "commands.h"
 #include "encoder.h"
+#include "bench.h"
+#include "sampler.h"
+#include "decimator.h"
+#include "capture.h"
+#include "burst.h"
+#include "profile.h"
 
 void processSerialCommands() {
   if (Serial.available()) {
     String cmd = Serial.readStringUntil('\n');
     cmd.trim();
-    
+
     if (cmd.equalsIgnoreCase("ZERO")) {
-      handleZeroCommand();
+      handleZeroCommand(-1);
+    } else if (cmd.length() > 5 && cmd.substring(0, 5).equalsIgnoreCase("ZERO ")) {
+      handleZeroCommand(cmd.substring(5).toInt());
+    } else if (cmd.equalsIgnoreCase("HOME")) {
+      handleHomeCommand(-1);
+    } else if (cmd.length() > 5 && cmd.substring(0, 5).equalsIgnoreCase("HOME ")) {
+      handleHomeCommand(cmd.substring(5).toInt());
+    } else if (cmd.equalsIgnoreCase("STATS")) {
+      handleStatsCommand();
+    } else if (cmd.equalsIgnoreCase("BENCH")) {
+      runVelocityBench();
+    } else if (cmd.equalsIgnoreCase("BENCH ISR")) {
+      runIsrBench();
+    } else if (cmd.equalsIgnoreCase("JITTER")) {
+      handleJitterCommand(false);
+    } else if (cmd.equalsIgnoreCase("JITTER RESET")) {
+      handleJitterCommand(true);
+    } else if (cmd.equalsIgnoreCase("RATE")) {
+      handleRateCommand("");
+    } else if (cmd.length() > 5 && cmd.substring(0, 5).equalsIgnoreCase("RATE ")) {
+      handleRateCommand(cmd.substring(5));
+    } else if (cmd.equalsIgnoreCase("FILTER")) {
+      handleFilterCommand("");
+    } else if (cmd.length() > 7 && cmd.substring(0, 7).equalsIgnoreCase("FILTER ")) {
+      handleFilterCommand(cmd.substring(7));
+    } else if (cmd.equalsIgnoreCase("CAPTURE")) {
+      printCaptureStatus();
+    } else if (cmd.equalsIgnoreCase("CAPTURE START")) {
+      startCapture();
+    } else if (cmd.equalsIgnoreCase("CAPTURE STOP")) {
+      stopCapture();
+      printCaptureStatus();
+    } else if (cmd.equalsIgnoreCase("CAPTURE DUMP")) {
+      dumpCapture();
+    } else if (cmd.equalsIgnoreCase("BURST")) {
+      printBurstStatus();
+    } else if (cmd.length() > 6 && cmd.substring(0, 6).equalsIgnoreCase("BURST ")) {
+      handleBurstCommand(cmd.substring(6));
+    } else if (cmd.equalsIgnoreCase("PROFILE")) {
+      printProfile();
+    } else if (cmd.equalsIgnoreCase("PROFILE RESET")) {
+      resetProfile();
     } else if (cmd.length() > 0) {
-      Serial.println(F("Unknown command. Available: ZERO"));
+      Serial.println(F("Unknown command. Available: ZERO [axis], HOME [axis], STATS, BENCH [ISR], JITTER [RESET], RATE [est out], FILTER [axis type param], CAPTURE [START|STOP|DUMP], BURST [ARM|TRIGGER|DUMP], PROFILE [RESET]"));
+    }
+  }
+}
+
+void handleZeroCommand(int axis) {
+  if (axis >= ENC_COUNT) {
+    Serial.printf("Invalid axis %d (0..%d)\n", axis, ENC_COUNT - 1);
+    return;
+  }
+  for (EncoderBase* enc : encoders) {
+    if (axis < 0 || enc->axis() == axis) {
+      enc->resetPosition();
     }
   }
+  if (axis < 0) {
+    Serial.println(F("Encoder position reset to zero"));
+  } else {
+    Serial.printf("Axis %d position reset to zero\n", axis);
+  }
 }
 
-void handleZeroCommand() {
-  resetPosition();
-  Serial.println(F("Encoder position reset to zero"));
+void handleHomeCommand(int axis) {
+#if USE_INDEX
+  if (axis >= ENC_COUNT) {
+    Serial.printf("Invalid axis %d (0..%d)\n", axis, ENC_COUNT - 1);
+    return;
+  }
+  for (EncoderBase* enc : encoders) {
+    if (axis < 0 || enc->axis() == axis) {
+      enc->armIndexZero();
+      Serial.printf("Axis %u: position zeroes at the next index pulse\n", enc->axis());
+    }
+  }
+#else
+  (void)axis;
+  Serial.println(F("Index handling disabled (USE_INDEX=0)"));
+#endif
+}
+
+void handleStatsCommand() {
+  for (EncoderBase* enc : encoders) {
+    const EdgeWindowStats& edges = enc->edgeStats();
+    float usPerTick = 1e6f / (float)enc->edgeTickHz();
+    EncoderDiagnostics diag = enc->diagnostics();
+    Serial.printf("STATS ax=%u edges=%u minIntUs=%.3f maxIntUs=%.3f ringOvf=%u\n",
+                  enc->axis(), (unsigned)edges.edges, edges.minIntervalTicks * usPerTick,
+                  edges.maxIntervalTicks * usPerTick, (unsigned)enc->edgeRingOverflows());
+    Serial.printf("ERRORS ax=%u invalid=%u inferred=%u glitches=%u zMismatch=%u\n",
+                  enc->axis(), (unsigned)diag.invalidTransitions, (unsigned)diag.inferredSteps,
+                  (unsigned)diag.glitches, (unsigned)diag.indexMismatches);
+#if USE_INDEX
+    IndexLatch latch = enc->indexLatch();
+    Serial.printf("INDEX ax=%u n=%u pos=%lld tUs=%u revErr=%d periodUs=%d\n", enc->axis(),
+                  (unsigned)latch.count, (long long)latch.position, (unsigned)latch.micros,
+                  (int)latch.revError, (int)latch.periodUs);
+#endif
+  }
+#if USE_SAMPLER_TASK
+  Serial.printf("QUEUE depth=%u hwm=%u/%d drops=%u\n", (unsigned)sampleQueueDepth(),
+                (unsigned)sampleQueueHighWater(), SAMPLE_QUEUE_SIZE,
+                (unsigned)sampleQueueDrops());
+#endif
+}
+
+void handleJitterCommand(bool reset) {
+#if USE_SAMPLER_TASK
+  SamplerTiming timing = getSamplerTiming();
+  Serial.printf("JITTER n=%u periodUs=%u minUs=%u maxUs=%u p99DevUs=%u\n",
+                (unsigned)timing.samples, (unsigned)timing.nominalPeriodUs, (unsigned)timing.minPeriodUs,
+                (unsigned)timing.maxPeriodUs, (unsigned)timing.p99DeviationUs);
+  if (reset) {
+    resetSamplerTiming();
+    Serial.println(F("Sampler timing stats reset"));
+  }
+#else
+  (void)reset;
+  Serial.println(F("Sampler task disabled (USE_SAMPLER_TASK=0)"));
+#endif
+}
+
+// "RATE" shows the rates, "RATE <estimateHz> <outputHz>" changes them
+void handleRateCommand(const String& args) {
+#if USE_SAMPLER_TASK
+  if (args.length() > 0) {
+    int space = args.indexOf(' ');
+    long estimateHz = args.substring(0, space).toInt();
+    long outputHz = (space > 0) ? args.substring(space + 1).toInt() : 0;
+    if (estimateHz <= 0 || outputHz <= 0 ||
+        !setSamplerRates((uint32_t)estimateHz, (uint32_t)outputHz)) {
+      Serial.printf("Invalid rates (estimate 1..%d Hz, output >= estimate/%u Hz)\n",
+                    1000000 / MIN_SAMPLE_US, (unsigned)CicDecimator::MAX_RATIO);
+      return;
+    }
+  }
+  // A new setting is applied on the sampler's next wake, so show what was asked
+  uint32_t periodUs, decimation;
+  getSamplerRates(periodUs, decimation, args.length() > 0);
+  Serial.printf("RATE estimate=%.1fHz (%uus) output=%.2fHz (CIC decimation %u)\n",
+                1e6f / periodUs, (unsigned)periodUs, 1e6f / (periodUs * decimation),
+                (unsigned)decimation);
+#else
+  (void)args;
+  Serial.println(F("Sampler task disabled (USE_SAMPLER_TASK=0)"));
+#endif
+}
+
+// "FILTER" shows each axis' smoothing filter, "FILTER <axis> <type> <param>"
+// selects one: EMA alpha, MA windows, SG windows or BW cutoff Hz. Axes whose
+// estimator is unsmoothed (Tracking, Regression, M/T) have none.
+void handleFilterCommand(const String& args) {
+  if (args.length() > 0) {
+    int first = args.indexOf(' ');
+    int second = (first > 0) ? args.indexOf(' ', first + 1) : -1;
+    if (second < 0) {
+      Serial.println(F("Usage: FILTER <axis> <EMA|MA|SG|BW> <param>"));
+      return;
+    }
+    int axis = args.substring(0, first).toInt();
+    String name = args.substring(first + 1, second);
+    float param = args.substring(second + 1).toFloat();
+
+    VelocityFilterType type;
+    if (name.equalsIgnoreCase("EMA")) {
+      type = VelocityFilterType::EMA;
+    } else if (name.equalsIgnoreCase("MA")) {
+      type = VelocityFilterType::MovingAverage;
+    } else if (name.equalsIgnoreCase("SG")) {
+      type = VelocityFilterType::SavitzkyGolay;
+    } else if (name.equalsIgnoreCase("BW")) {
+      type = VelocityFilterType::Butterworth;
+    } else {
+      Serial.printf("Unknown filter %s (EMA, MA, SG, BW)\n", name.c_str());
+      return;
+    }
+    if (axis < 0 || axis >= ENC_COUNT) {
+      Serial.printf("Invalid axis %d (0..%d)\n", axis, ENC_COUNT - 1);
+      return;
+    }
+    if (!encoders[axis]->velocityFiltered()) {
+      Serial.printf("Axis %d: its estimator has no smoothing filter (Tracking, Regression, M/T)\n",
+                    axis);
+      return;
+    }
+    if (!encoders[axis]->setVelocityFilter(type, param)) {
+      Serial.printf("Invalid %s parameter (EMA 0..1, MA 2..%u, SG 3..%u, BW > 0 Hz)\n",
+                    name.c_str(), (unsigned)VelocityFilter::MAX_TAPS,
+                    (unsigned)VelocityFilter::MAX_TAPS);
+      return;
+    }
+    Serial.printf("FILTER ax=%d %s %.3f\n", axis, VelocityFilter::name(type), param);
+    return;
+  }
+
+  for (EncoderBase* enc : encoders) {
+    if (!enc->velocityFiltered()) {
+      Serial.printf("FILTER ax=%u none\n", enc->axis());
+      continue;
+    }
+    const VelocityFilter& filter = enc->velocityFilter();
+    Serial.printf("FILTER ax=%u %s %.3f\n", enc->axis(), VelocityFilter::name(filter.type()),
+                  filter.param());
+  }
+}
+
+void handleBurstCommand(const String& args) {
+  if (args.equalsIgnoreCase("TRIGGER")) {
+    triggerBurst();
+    printBurstStatus();
+  } else if (args.equalsIgnoreCase("DUMP")) {
+    dumpBurst(-1);
+  } else if (args.length() > 5 && args.substring(0, 5).equalsIgnoreCase("DUMP ")) {
+    dumpBurst(args.substring(5).toInt());
+  } else if (args.equalsIgnoreCase("ARM") ||
+             (args.length() > 4 && args.substring(0, 4).equalsIgnoreCase("ARM "))) {
+    // ARM [preMs postMs [speedCps]]
+    long preMs = BURST_PRE_MS, postMs = BURST_POST_MS;
+    float speedCps = 0.0f;
+    if (args.length() > 4) {
+      String rest = args.substring(4);
+      rest.trim();
+      int first = rest.indexOf(' ');
+      int second = (first > 0) ? rest.indexOf(' ', first + 1) : -1;
+      preMs = rest.substring(0, first).toInt();
+      postMs = (first > 0) ? rest.substring(first + 1, second).toInt() : -1;
+      if (second > 0) speedCps = rest.substring(second + 1).toFloat();
+    }
+    if (preMs < 0 || postMs < 0 || !armBurst((uint32_t)preMs, (uint32_t)postMs, speedCps)) {
+      Serial.println(F("Cannot arm: BURST ARM [preMs postMs [speedCps]] within the buffer length"));
+      return;
+    }
+    printBurstStatus();
+  } else {
+    Serial.println(F("Usage: BURST [ARM [preMs postMs [speedCps]] | TRIGGER | DUMP [chunk]]"));
+  }
 }
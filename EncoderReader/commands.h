@@ -5,6 +5,12 @@
 
 // ====== COMMAND PROCESSING ======
 void processSerialCommands();
-void handleZeroCommand();
+void handleZeroCommand(int axis);  // axis < 0 = all axes
+void handleHomeCommand(int axis);  // axis < 0 = all axes
+void handleStatsCommand();
+void handleJitterCommand(bool reset);
+void handleRateCommand(const String& args);  // "" = show, "<estimateHz> <outputHz>" = set
+void handleFilterCommand(const String& args);  // "" = show, "<axis> <EMA|MA|SG|BW> <param>" = set
+void handleBurstCommand(const String& args);   // ARM [preMs postMs [cps]], TRIGGER, DUMP [chunk]
 
 #endif // COMMANDS_H
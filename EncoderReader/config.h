@@ -12,8 +12,77 @@
 
 // ====== HIGH PERFORMANCE CONFIG ======
 #define USE_HARDWARE_PCNT  1   // 1 = use ESP32 PCNT peripheral, 0 = use ISR
-#define MIN_EDGE_INTERVAL_US 10 // Minimum time between edges to filter glitches
+#define USE_MCPWM_CAPTURE  1   // 1 = PCNT mode timestamps A/B edges with MCPWM capture (axes 0-1)
+#define GLITCH_FLOOR_US  1     // Adaptive glitch filter (ISR mode): reversals closer than
+#define GLITCH_CEIL_US   20    // recent edge interval >> GLITCH_INTERVAL_SHIFT, clamped to
+#define GLITCH_INTERVAL_SHIFT 2 // [FLOOR, CEIL] µs, are bounces. Same-direction edges always pass.
+#define ISR_BACKEND_ARDUINO 0  // attachInterruptArg() per pin, through the Arduino dispatcher
+#define ISR_BACKEND_IDF     1  // One raw IRAM GPIO handler for all encoder pins (no other
+                               // attachInterrupt users possible; pins must be < 32)
+#define ISR_BACKEND_DEDIC   2  // Same handler, A/B/Z read from an S3 dedicated GPIO bundle with
+                               // one CPU instruction (3 of 8 input channels per axis)
+#define ISR_BACKEND ISR_BACKEND_IDF  // ISR mode only
+#define INFER_DOUBLE_STEPS 0   // 1 = count an invalid AB jump as 2 steps in the current direction (ISR mode)
+#define INDEX_TOLERANCE_COUNTS 2 // Z-to-Z distance may differ from 4*PPR by this much (Z pulse width)
+#define INDEX_AUTO_ZERO 0      // 0 = off, 1 = zero at the first Z after boot / HOME, 2 = zero at every Z
 #define VELOCITY_TIMEOUT_US  500000 // 500ms - zero velocity if no edges
 #define ADAPTIVE_BLENDING 1    // 1 = adaptive window/edge blending, 0 = fixed 50/50
+#define USE_TRACKING_OBSERVER 0 // 1 = alpha-beta-gamma observer instead of blend + EMA
+#define OBSERVER_THETA 0.70f   // 0..1 observer discount (higher = smoother, more lag)
+#define USE_EDGE_REGRESSION 0  // 1 = least-squares fit over recent edges instead of blend + EMA
+#define REGRESSION_EDGES 16    // Edges in the fit (2..32)
+#define REGRESSION_SPAN_US 50000 // Oldest edge kept in the fit (bounds lag at low speed)
+#define USE_MT_METHOD 0        // 1 = M/T: counts over the exact first-to-last edge time, no thresholds
+#define USE_FIXED_POINT 0      // 1 = Q16 fixed-point window/edge/EMA math (blend estimators)
+#define ESTIMATE_ACCEL  1      // 1 = acceleration/jerk from the tracking observer (acc= output)
+#define REPORT_JERK     0      // 1 = also print jerk= in the output stream
+#define REPORT_PREDICTED_POS 0 // 1 = print pPos=, the position extrapolated PREDICT_AHEAD_US
+#define PREDICT_AHEAD_US 0     //     past the sample time (e.g. the host's UART latency)
+#define EDGE_RING_SIZE  256    // Per-axis edge timestamp ring (power of two), drained once per
+                               // estimation period: size it >= max edge rate x period (256 =
+                               // 25.6k edges/s at 10 ms). Past that the ring drops edges and the
+                               // regression falls back to window counts until it keeps up again
+
+#define USE_PROFILING   0      // 1 = CCOUNT histograms of ISRs, speed update and print (PROFILE)
+
+// ====== SAMPLING CONFIG ======
+#define USE_SAMPLER_TASK 1     // 1 = esp_timer-driven sampling task, 0 = poll in loop()
+#define SAMPLER_CORE     0     // Acquisition core; loop() (telemetry/commands) runs on core 1
+#define SAMPLER_PRIORITY (ESP_TASK_TIMER_PRIO - 1)  // Above loop() (1), below the esp_timer task (22) that wakes it
+#define SAMPLE_QUEUE_SIZE 64   // Acquisition -> telemetry records (power of two)
+#define OUTPUT_DECIMATION 1    // Sampler mode: one record per N estimation periods (CIC filtered)
+#define MIN_SAMPLE_US   100    // Fastest estimation period the RATE command accepts (10 kHz)
+
+// ====== RAW EDGE CAPTURE ======
+#define USE_RMT_CAPTURE 1      // 1 = CAPTURE command: RMT records the A/B edge train of one axis
+#define CAPTURE_AXIS    0      // Axis whose A/B pins are recorded
+#define CAPTURE_RMT_CLK_DIV 8  // RMT tick = N APB cycles (8 = 100 ns; levels up to 3.2 ms per item)
+#define CAPTURE_BUFFER_BYTES 16384 // Per channel (4 bytes = 2 levels); allocated only while capturing
+#define CAPTURE_FILTER_CYCLES 0 // RMT glitch filter in APB cycles (0 = off, keep bounces)
+#define CAPTURE_EDGE_EVENTS 4096 // A/B edge trace on the encoder edge clock (8 bytes each, A/B phase)
+#define USE_BURST_CAPTURE 1    // 1 = BURST command: triggered capture of every sampler period into PSRAM
+#define BURST_SAMPLES   65536  // Records in the PSRAM ring (20 bytes each, shared by all axes)
+#define BURST_CHUNK_RECORDS 256 // Records per CRC-checked dump chunk
+#define BURST_PRE_MS    100    // Default pre-trigger history (BURST ARM)
+#define BURST_POST_MS   100    // Default post-trigger recording (BURST ARM)
+#define BURST_TRIGGER_ON_INDEX_ERROR 1 // 1 = a Z-to-Z miscount triggers the burst
+#define BURST_TRIGGER_PIN -1   // GPIO that triggers the burst (-1 = none)
+#define BURST_TRIGGER_LEVEL 0  //     at this level
+
+// ====== MULTI-AXIS CONFIG ======
+// Axis 0 uses ENC_PIN_A/B/Z and ENC_PPR above, axes 1..3 the pins below
+#define ENC_COUNT    1         // Number of encoders (1..4, one PCNT unit each)
+#define ENC1_PIN_A   4
+#define ENC1_PIN_B   5
+#define ENC1_PIN_Z   6
+#define ENC1_PPR     1024
+#define ENC2_PIN_A   7
+#define ENC2_PIN_B   8
+#define ENC2_PIN_Z   9
+#define ENC2_PPR     1024
+#define ENC3_PIN_A   10
+#define ENC3_PIN_B   11
+#define ENC3_PIN_Z   12
+#define ENC3_PPR     1024
 
 #endif // CONFIG_H
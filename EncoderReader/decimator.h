@@ -0,0 +1,55 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+
+// ====== CIC DECIMATOR ======
+// Hardware independent. Second-order cascaded integrator-comb: two running
+// sums at the estimation rate and two differences at the output rate. That
+// is a length-2R triangular FIR (sinc^2 response, nulls at every multiple
+// of the output rate) for two adds per input, so the output is anti-aliased
+// instead of one picked sample. The integrators wrap in unsigned 64-bit
+// arithmetic and the combs undo it exactly, so nothing drifts. Inputs are
+// Q8 and clamped so that value * R^2 always fits the 64-bit state.
+class CicDecimator {
+public:
+  static constexpr uint32_t MAX_RATIO = 256;
+  static constexpr float MAX_INPUT = 1e9f;  // |x| clamp, in input units
+
+  // Output one value per `ratio` inputs; resets the filter state
+  void configure(uint32_t newRatio) {
+    ratio = (newRatio < 1) ? 1 : (newRatio > MAX_RATIO ? MAX_RATIO : newRatio);
+    scale = 1.0f / (256.0f * (float)ratio * (float)ratio);
+    phase = 0;
+    integ1 = integ2 = comb1Prev = comb2Prev = 0;
+  }
+
+  // Returns true and sets out every ratio-th call
+  bool push(float x, float& out) {
+    if (x > MAX_INPUT) x = MAX_INPUT;
+    if (x < -MAX_INPUT) x = -MAX_INPUT;
+    integ1 += (uint64_t)(int64_t)(x * 256.0f);
+    integ2 += integ1;
+    if (++phase < ratio) return false;
+    phase = 0;
+
+    uint64_t comb1 = integ2 - comb2Prev;
+    comb2Prev = integ2;
+    uint64_t comb2 = comb1 - comb1Prev;
+    comb1Prev = comb1;
+    out = (float)(int64_t)comb2 * scale;
+    return true;
+  }
+
+  uint32_t decimation() const { return ratio; }
+
+private:
+  uint32_t ratio = 1;
+  uint32_t phase = 0;
+  float scale = 1.0f / 256.0f;
+  uint64_t integ1 = 0, integ2 = 0;
+  uint64_t comb1Prev = 0;  // Previous first-comb output
+  uint64_t comb2Prev = 0;  // integ2 at the previous output
+};
+
+#endif // DECIMATOR_H
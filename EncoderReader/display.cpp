@@ -1,35 +1,95 @@
 #include "display.h"
 #include "config.h"
+#include "profile.h"
 
 void printSystemStatus() {
   Serial.println(F("ESP32-S3 High-Performance Quadrature Encoder"));
-  Serial.printf("PPR=%d, Sample Rate=%dms\n", ENC_PPR, SPEED_SAMPLE_US / 1000);
+  Serial.printf("Encoders=%d, Sample Rate=%dms\n", ENC_COUNT, SPEED_SAMPLE_US / 1000);
   
 #if USE_HARDWARE_PCNT
   Serial.println(F("Mode: Hardware PCNT (Maximum Performance)"));
+#if USE_MCPWM_CAPTURE
+  Serial.println(F("Edge Timing: MCPWM capture (APB clock)"));
+#endif
+#else
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+  Serial.println(F("Mode: Optimized ISR (IDF GPIO handler, dedicated GPIO read)"));
+#elif ISR_BACKEND == ISR_BACKEND_IDF
+  Serial.println(F("Mode: Optimized ISR (single IDF GPIO handler)"));
 #else
-  Serial.println(F("Mode: Optimized ISR"));
+  Serial.println(F("Mode: Optimized ISR (Arduino attachInterrupt)"));
+#endif
 #endif
 
-#if ADAPTIVE_BLENDING
+#if USE_TRACKING_OBSERVER
+  Serial.printf("Velocity: Alpha-Beta-Gamma Tracking Observer (theta=%.2f)\n", OBSERVER_THETA);
+#elif USE_EDGE_REGRESSION
+  Serial.printf("Velocity: Least-Squares Edge Regression (%d edges, %d us span)\n",
+                REGRESSION_EDGES, REGRESSION_SPAN_US);
+#elif USE_MT_METHOD
+  Serial.println(F("Velocity: M/T (edge-aligned counts over exact edge time)"));
+#elif ADAPTIVE_BLENDING
   Serial.println(F("Velocity: Adaptive Window/Edge Blending"));
 #else
   Serial.println(F("Velocity: Fixed 50/50 Blending"));
 #endif
 
-  Serial.printf("Glitch Filter: %d microseconds\n", MIN_EDGE_INTERVAL_US);
+#if USE_FIXED_POINT
+  Serial.println(F("Velocity Math: Q16 fixed-point"));
+#endif
+#if USE_INDEX && INDEX_AUTO_ZERO == 1
+  Serial.println(F("Index: zero at the first Z pulse"));
+#elif USE_INDEX && INDEX_AUTO_ZERO == 2
+  Serial.println(F("Index: zero at every Z pulse"));
+#endif
+#if USE_PROFILING
+  Serial.println(F("Profiling: CCOUNT histograms enabled"));
+#endif
+#if USE_RMT_CAPTURE
+  Serial.printf("Capture: RMT raw edges and A/B edge trace of axis %d on demand (CAPTURE)\n", CAPTURE_AXIS);
+#endif
+#if USE_BURST_CAPTURE && USE_SAMPLER_TASK
+  Serial.printf("Burst: PSRAM ring of %d records, %d/%dms pre/post trigger (BURST)\n",
+                BURST_SAMPLES, BURST_PRE_MS, BURST_POST_MS);
+#endif
+
+#if !USE_HARDWARE_PCNT
+  Serial.printf("Glitch Filter: adaptive reversal filter, %d..%d microseconds\n",
+                GLITCH_FLOOR_US, GLITCH_CEIL_US);
+#endif
   Serial.printf("Velocity Timeout: %d ms\n", VELOCITY_TIMEOUT_US / 1000);
   
-  Serial.println(F("Commands: ZERO"));
-  Serial.println(F("Output Format: Pos=<position> cps=<counts/sec> rpm=<rpm> [Z]"));
+  Serial.println(F("Commands: ZERO [axis], HOME [axis], STATS, BENCH [ISR], JITTER [RESET], RATE [est out], FILTER [axis type param], CAPTURE [START|STOP|DUMP], BURST [ARM|TRIGGER|DUMP], PROFILE [RESET]"));
+  Serial.println(F("Output Format: Pos=<position> [pPos=<predicted>] cps=<counts/sec> rpm=<rpm> [rpmZ=<index rpm>] [acc=<counts/s^2>] [jerk=<counts/s^3>] ax=<axis> [Z] [inv=<n> glt=<n> zerr=<n>]"));
   Serial.println();
 }
 
-void printEncoderData(int64_t position, float rpm, float countsPerSec, bool indexSeen) {
-  Serial.printf("Pos=%lld cps=%.1f rpm=%.2f", 
-                (long long)position, countsPerSec, rpm);
-  if (indexSeen) {
+void printEncoderData(const SampleRecord& sample) {
+  PROFILE_BEGIN();
+  Serial.printf("Pos=%lld", (long long)sample.position);
+#if REPORT_PREDICTED_POS
+  Serial.printf(" pPos=%.2f", sample.predictedPosition);
+#endif
+  Serial.printf(" cps=%.1f rpm=%.2f", sample.countsPerSec, sample.rpm);
+#if USE_INDEX
+  Serial.printf(" rpmZ=%.3f", sample.indexRpm);
+#endif
+#if ESTIMATE_ACCEL
+  Serial.printf(" acc=%.0f", sample.accel);
+#if REPORT_JERK
+  Serial.printf(" jerk=%.0f", sample.jerk);
+#endif
+#endif
+  Serial.printf(" ax=%u", sample.axis);
+  if (sample.indexSeen) {
     Serial.print(" Z");
   }
+  // Error counters only appear once something went wrong
+  const EncoderDiagnostics& diag = sample.diag;
+  if (diag.invalidTransitions || diag.glitches || diag.indexMismatches) {
+    Serial.printf(" inv=%u glt=%u zerr=%u", (unsigned)diag.invalidTransitions,
+                  (unsigned)diag.glitches, (unsigned)diag.indexMismatches);
+  }
   Serial.println();
+  PROFILE_END(PROF_PRINT);
 }
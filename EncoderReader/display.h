@@ -2,9 +2,10 @@
 #define DISPLAY_H
 
 #include <Arduino.h>
+#include "sample_queue.h"
 
 // ====== DISPLAY FUNCTIONS ======
 void printSystemStatus();
-void printEncoderData(int64_t position, float rpm, float countsPerSec, bool indexSeen);
+void printEncoderData(const SampleRecord& sample);
 
 #endif // DISPLAY_H
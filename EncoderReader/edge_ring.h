@@ -0,0 +1,68 @@
+#ifndef EDGE_RING_H
+#define EDGE_RING_H
+
+#include <stdint.h>
+
+// ====== PER-EDGE EVENT ======
+struct EdgeEvent {
+  uint32_t ticks;   // Timestamp of the edge (encoder edge timebase)
+  int8_t delta;     // Count change (+1 / -1, +-2 for an inferred double step)
+  uint8_t stateAB;  // New AB state after the edge
+  bool glitch;      // Rejected bounce: counts, but its time is no edge time
+};
+
+// ====== LOCK-FREE EDGE RING ======
+// Single producer (quadrature ISR) / single consumer (sampling code).
+// Indices run free and are masked on access, so N must be a power of two.
+// The producer only writes head, the consumer only writes tail, so neither
+// side ever masks interrupts. A full ring drops the new edge and counts it.
+// Every count change is pushed, so the deltas sum to the position as long
+// as nothing overflowed.
+template <uint32_t N>
+class EdgeRing {
+public:
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Edge ring size must be a power of two");
+
+  // Producer side (ISR): a load, a compare, one store and the barrier
+  inline __attribute__((always_inline)) bool push(uint32_t ticks, int8_t delta, uint8_t stateAB,
+                                                  bool glitch = false) {
+    uint32_t h = head;
+    if (h - tail >= N) {
+      overflowCount = overflowCount + 1;
+      return false;
+    }
+    EdgeEvent& e = buffer[h & (N - 1)];
+    e.ticks = ticks;
+    e.delta = delta;
+    e.stateAB = stateAB;
+    e.glitch = glitch;
+    __sync_synchronize();  // Publish the event before the index
+    head = h + 1;
+    return true;
+  }
+
+  // Consumer side: copies the oldest event, returns false when empty
+  bool pop(EdgeEvent& out) {
+    uint32_t t = tail;
+    if (t == head) return false;
+    __sync_synchronize();  // Read the event only after seeing the index
+    out = buffer[t & (N - 1)];
+    __sync_synchronize();
+    tail = t + 1;
+    return true;
+  }
+
+  uint32_t size() const { return head - tail; }
+  uint32_t overflows() const { return overflowCount; }
+
+  // Consumer side: discard everything queued so far
+  void clear() { tail = head; }
+
+private:
+  EdgeEvent buffer[N];
+  volatile uint32_t head = 0;
+  volatile uint32_t tail = 0;
+  volatile uint32_t overflowCount = 0;
+};
+
+#endif // EDGE_RING_H
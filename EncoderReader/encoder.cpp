@@ -1,119 +1,257 @@
 #include "encoder.h"
+#include "encoder_config.h"
 
-// ====== ENCODER STATE ======
-volatile int64_t positionCounts = 0;
-volatile int8_t  lastStateAB = 0;
-volatile uint32_t lastEdgeMicros = 0;
-volatile uint32_t edgeDeltaMicros = 0;
-volatile bool indexFlag = false;
-volatile int8_t lastDeltaSign = 1;  // Sign of last delta (+1 or -1)
-
-float emaCountsPerSec = 0.0f;
-int64_t lastSamplePos = 0;
-
-#if USE_HARDWARE_PCNT
-pcnt_unit_t pcnt_unit = PCNT_UNIT_0;
-int16_t pcnt_overflow_count = 0;
+// ====== ENCODER INSTANCES ======
+static Encoder<Axis0Config> encoder0;
+#if ENC_COUNT > 1
+static Encoder<Axis1Config> encoder1;
+#endif
+#if ENC_COUNT > 2
+static Encoder<Axis2Config> encoder2;
+#endif
+#if ENC_COUNT > 3
+static Encoder<Axis3Config> encoder3;
 #endif
 
-// Fast GPIO pin masks for direct register access (ESP32-S3)
-#define ENC_PIN_A_MASK (1ULL << ENC_PIN_A)
-#define ENC_PIN_B_MASK (1ULL << ENC_PIN_B)
-
-// Transition table for quadrature (old<<2 | new) -> delta
-// States: A=(bit1), B=(bit0)
-constexpr int8_t quadTable[16] = {
-  0,  // 0000 (00->00)
-  +1, // 0001 (00->01)
-  -1, // 0010 (00->10)
-  0,  // 0011 (00->11 invalid skip)
-  -1, // 0100 (01->00)
-  0,  // 0101 (01->01)
-  0,  // 0110 (01->10 invalid)
-  +1, // 0111 (01->11)
-  +1, // 1000 (10->00)
-  0,  // 1001 (10->01 invalid)
-  0,  // 1010 (10->10)
-  -1, // 1011 (10->11)
-  0,  // 1100 (11->00 invalid)
-  -1, // 1101 (11->01)
-  +1, // 1110 (11->10)
-  0   // 1111 (11->11)
+EncoderBase* const encoders[ENC_COUNT] = {
+  &encoder0,
+#if ENC_COUNT > 1
+  &encoder1,
+#endif
+#if ENC_COUNT > 2
+  &encoder2,
+#endif
+#if ENC_COUNT > 3
+  &encoder3,
+#endif
 };
 
+void initEncoders() {
+  for (EncoderBase* enc : encoders) {
+    enc->begin();
+  }
+}
+
+void updateEncoderSpeeds(uint32_t currentTime, uint32_t slackUs) {
+  PROFILE_BEGIN();
+  for (EncoderBase* enc : encoders) {
+    enc->updateSpeed(currentTime, slackUs);
+  }
+  PROFILE_END(PROF_UPDATE_SPEED);
+}
+
+EncoderBase::EncoderBase(uint8_t axis, int pinA, int pinB, int pinZ, pcnt_unit_t unit,
+                         uint32_t countsPerRev)
+  : axisId(axis), pinA(pinA), pinB(pinB), pinZ(pinZ), pcntUnit(unit),
+    pinAMask(1ULL << pinA), pinBMask(1ULL << pinB), countsPerRev(countsPerRev) {}
+
 #if USE_HARDWARE_PCNT
 
 // ====== PCNT IMPLEMENTATION (HIGH PERFORMANCE) ======
 
-IRAM_ATTR void pcnt_overflow_handler(void* arg) {
-  pcnt_unit_t unit = (pcnt_unit_t)(uintptr_t)arg;
-  
-  // Get overflow direction
-  uint32_t status = PCNT.int_st.val;
-  if (status & (1 << (2 * unit))) {
-    pcnt_overflow_count++;  // Positive overflow
-  } else if (status & (1 << (2 * unit + 1))) {
-    pcnt_overflow_count--;  // Negative overflow
+// Hardware counter limits; the counter resets to 0 when it reaches either one
+constexpr int16_t PCNT_H_LIM = 32767;
+constexpr int16_t PCNT_L_LIM = -32768;
+
+EncoderBase* EncoderBase::pcntUnits[PCNT_UNIT_MAX] = {};
+
+static pcnt_count_mode_t toPcntCountMode(PcntEdgeAction action) {
+  switch (action) {
+    case PcntEdgeAction::Inc: return PCNT_COUNT_INC;
+    case PcntEdgeAction::Dec: return PCNT_COUNT_DEC;
+    default:                  return PCNT_COUNT_DIS;
   }
-  
-  // Clear interrupt
-  PCNT.int_clr.val = BIT(unit);
 }
 
-void initPCNT() {
-  Serial.println(F("Initializing PCNT (Hardware Pulse Counter)..."));
-  
-  // Configure PCNT unit
+static pcnt_ctrl_mode_t toPcntCtrlMode(PcntCtrlAction action) {
+  switch (action) {
+    case PcntCtrlAction::Keep:    return PCNT_MODE_KEEP;
+    case PcntCtrlAction::Reverse: return PCNT_MODE_REVERSE;
+    default:                      return PCNT_MODE_DISABLE;
+  }
+}
+
+void EncoderBase::configPCNTChannel(pcnt_channel_t channel, int pulsePin, int ctrlPin,
+                                const PcntChannelModel& model) {
   pcnt_config_t pcnt_config = {
-    .pulse_gpio_num = ENC_PIN_A,
-    .ctrl_gpio_num = ENC_PIN_B,
-    .lctrl_mode = PCNT_MODE_REVERSE,  // Reverse when B is low
-    .hctrl_mode = PCNT_MODE_KEEP,     // Keep when B is high
-    .pos_mode = PCNT_COUNT_INC,       // Increment on positive edge
-    .neg_mode = PCNT_COUNT_DIS,       // Disable negative edge counting
-    .counter_h_lim = 32767,
-    .counter_l_lim = -32768,
-    .unit = pcnt_unit,
-    .channel = PCNT_CHANNEL_0,
+    .pulse_gpio_num = pulsePin,
+    .ctrl_gpio_num = ctrlPin,
+    .lctrl_mode = toPcntCtrlMode(model.lctrl),
+    .hctrl_mode = toPcntCtrlMode(model.hctrl),
+    .pos_mode = toPcntCountMode(model.pos),
+    .neg_mode = toPcntCountMode(model.neg),
+    .counter_h_lim = PCNT_H_LIM,
+    .counter_l_lim = PCNT_L_LIM,
+    .unit = pcntUnit,
+    .channel = channel,
   };
-  
   pcnt_unit_config(&pcnt_config);
-  
-  // Set filter (glitch rejection)
-  pcnt_set_filter_value(pcnt_unit, 1000);  // ~1µs filter
-  pcnt_filter_enable(pcnt_unit);
-  
+}
+
+IRAM_ATTR void EncoderBase::onPCNTOverflow(uint32_t status) {
+  positionLock.writeBegin();
+  if (status & PCNT_EVT_H_LIM) {
+    pcntBaseCount += PCNT_H_LIM;  // Positive overflow
+  } else if (status & PCNT_EVT_L_LIM) {
+    pcntBaseCount += PCNT_L_LIM;  // Negative overflow
+  }
+  positionLock.writeEnd();
+}
+
+// Shared by all units: one interrupt, dispatched by the unit bits in int_st
+IRAM_ATTR void EncoderBase::pcnt_overflow_handler(void* /*arg*/) {
+  PROFILE_BEGIN();
+  uint32_t intr = PCNT.int_st.val;
+  for (int unit = 0; unit < PCNT_UNIT_MAX; unit++) {
+    if (!(intr & BIT(unit))) continue;
+    // Latched event bits of this unit (same layout as pcnt_evt_type_t)
+    uint32_t status = PCNT.status_unit[unit].val;
+    EncoderBase* enc = pcntUnits[unit];
+    if (enc) {
+      enc->onPCNTOverflow(status);
+    }
+    // Clear only after the base count is updated; readers watch int_raw
+    PCNT.int_clr.val = BIT(unit);
+  }
+  PROFILE_END(PROF_PCNT_ISR);
+}
+
+void EncoderBase::initPCNT() {
+  Serial.printf("Axis %u: Initializing PCNT unit %d...\n", axisId, (int)pcntUnit);
+
+  // True X4 decoding: both edges of A and B are counted, each channel
+  // uses the other signal for direction (see quadrature.h for the model)
+  configPCNTChannel(PCNT_CHANNEL_0, pinA, pinB, PCNT_CH_A);
+  configPCNTChannel(PCNT_CHANNEL_1, pinB, pinA, PCNT_CH_B);
+
+  // Set filter (glitch rejection), in APB clock cycles (80 MHz)
+  pcnt_set_filter_value(pcntUnit, 80);  // ~1µs filter
+  pcnt_filter_enable(pcntUnit);
+
   // Enable overflow/underflow interrupts
-  pcnt_event_enable(pcnt_unit, PCNT_EVT_H_LIM);
-  pcnt_event_enable(pcnt_unit, PCNT_EVT_L_LIM);
-  
-  // Install ISR service and add handler
-  pcnt_isr_service_install(ESP_INTR_FLAG_IRAM);
-  pcnt_isr_handler_add(pcnt_unit, pcnt_overflow_handler, (void*)pcnt_unit);
-  
+  pcnt_event_enable(pcntUnit, PCNT_EVT_H_LIM);
+  pcnt_event_enable(pcntUnit, PCNT_EVT_L_LIM);
+
+  // Register the shared handler once, then route this unit to us
+  static bool isrRegistered = false;
+  if (!isrRegistered) {
+    pcnt_isr_register(pcnt_overflow_handler, nullptr, ESP_INTR_FLAG_IRAM, nullptr);
+    isrRegistered = true;
+  }
+  pcntUnits[pcntUnit] = this;
+  pcnt_intr_enable(pcntUnit);
+
   // Start counting
-  pcnt_counter_clear(pcnt_unit);
-  pcnt_counter_resume(pcnt_unit);
+  pcnt_counter_clear(pcntUnit);
+  pcnt_counter_resume(pcntUnit);
 }
 
-int64_t readPCNTPosition() {
+#if USE_MCPWM_CAPTURE
+
+// ====== MCPWM EDGE TIMESTAMPS (PCNT MODE) ======
+
+void EncoderBase::initCapture() {
+  if (axisId >= MCPWM_CAPTURE_AXES) {
+    Serial.printf("Axis %u: no MCPWM capture unit left, window-only velocity\n", axisId);
+    return;
+  }
+  mcpwm_unit_t unit = (mcpwm_unit_t)axisId;
+
+  // Direction comes from the AB state, so seed it before the first edge
+  uint64_t gpio_in = GPIO.in;
+  uint8_t a = (gpio_in & pinAMask) ? 1 : 0;
+  uint8_t b = (gpio_in & pinBMask) ? 1 : 0;
+  lastStateAB = (a << 1) | b;
+
+  // The GPIO matrix lets the same pins drive PCNT and the capture inputs
+  mcpwm_gpio_init(unit, MCPWM_CAP_0, pinA);
+  mcpwm_gpio_init(unit, MCPWM_CAP_1, pinB);
+
+  mcpwm_capture_config_t conf = {
+    .cap_edge = MCPWM_BOTH_EDGE,
+    .cap_prescale = 1,
+    .capture_cb = captureCallback,
+    .user_data = this,
+  };
+  mcpwm_capture_enable_channel(unit, MCPWM_SELECT_CAP0, &conf);
+  mcpwm_capture_enable_channel(unit, MCPWM_SELECT_CAP1, &conf);
+
+  Serial.printf("Axis %u: MCPWM%d capture timestamps on A/B\n", axisId, (int)unit);
+}
+
+IRAM_ATTR bool EncoderBase::captureCallback(mcpwm_unit_t /*mcpwm*/, mcpwm_capture_channel_id_t channel,
+                                            const cap_event_data_t* edata, void* arg) {
+  PROFILE_BEGIN();
+  // Each axis owns a whole MCPWM unit, so the channel alone tells A from B
+  static_cast<EncoderBase*>(arg)->onCaptureEdge(channel == MCPWM_SELECT_CAP0,
+                                                edata->cap_edge == MCPWM_POS_EDGE,
+                                                edata->cap_value);
+  PROFILE_END(PROF_EDGE_ISR);
+  return false;  // No task woken
+}
+
+IRAM_ATTR void EncoderBase::onCaptureEdge(bool isA, bool rising, uint32_t ticks) {
+  // Only the captured signal's level comes with the event. The other one is
+  // taken from the state the previous events left, not read live: by the
+  // time this runs it may already have moved past this edge.
+  uint8_t bit = isA ? 0b10 : 0b01;
+  int8_t newState = rising ? (lastStateAB | bit) : (lastStateAB & ~bit);
+  if (newState == lastStateAB) {
+    // Same level twice on one channel: its opposite edge was missed
+    invalidTransitions = invalidTransitions + 1;
+    return;
+  }
+  int8_t delta = quadDelta(lastStateAB, newState);  // One bit changed: +-1
+  lastStateAB = newState;
+  // Only timing and direction here; PCNT owns the count
+
+  // The two channels are serviced in order, so a late one can look older
+  uint32_t interval = ticks - lastEdgeTicks;
+  positionLock.writeBegin();
+  if ((int32_t)interval > 0 && lastEdgeTicks != 0) {
+    edgeDeltaTicks = interval;
+  }
+  lastEdgeTicks = ticks;
+  lastEdgeMicros = micros_fast();
+  lastDeltaSign = (delta > 0) ? 1 : -1;
+  positionLock.writeEnd();
+  edgeRing.push(ticks, delta, newState);
+}
+
+#endif  // USE_MCPWM_CAPTURE
+
+bool EncoderBase::pcntWrapPending() const {
+  // The counter wraps before the overflow ISR runs; while its interrupt is
+  // still pending, base and count belong to different generations
+  return (PCNT.int_raw.val & BIT(pcntUnit)) != 0;
+}
+
+int64_t EncoderBase::readPCNTPosition() const {
+  int64_t base;
   int16_t count;
-  pcnt_get_counter_value(pcnt_unit, &count);
-  
-  // Combine overflow count with current count (quadrature = 4x multiplication)
-  return ((int64_t)pcnt_overflow_count * 65536LL + count) * 4;
+  readWrapped(positionLock, [&] {
+    base = pcntBaseCount - indexOffset;
+    pcnt_get_counter_value(pcntUnit, &count);
+  }, [this] { return pcntWrapPending(); });
+
+  // Hardware already counts every edge (X4), just extend to 64 bits
+  // (the base also carries the index zeroing offset)
+  return base + count;
 }
 
-void initEncoder() {
-  Serial.printf("PPR=%d, Using PCNT Hardware Counter\n", ENC_PPR);
-  
+void EncoderBase::begin() {
+  Serial.printf("Axis %u: PPR=%u, Using PCNT Hardware Counter\n", axisId, (unsigned)ppr());
+
   // Initialize pins for PCNT (no pullups needed, handled by PCNT)
   initPCNT();
-  
+#if USE_MCPWM_CAPTURE
+  initCapture();
+#endif
+
 #if USE_INDEX
   // Z pin still needs ISR since PCNT doesn't handle index
-  pinMode(ENC_PIN_Z, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(ENC_PIN_Z), isrZ, RISING);
+  pinMode(pinZ, INPUT_PULLUP);
+  attachInterruptArg(digitalPinToInterrupt(pinZ), isrZ, this, RISING);
 #endif
 
   lastEdgeMicros = micros_fast();
@@ -123,59 +261,190 @@ void initEncoder() {
 
 // ====== OPTIMIZED ISR IMPLEMENTATION ======
 
-IRAM_ATTR void updateFromAB_Fast() {
-  uint32_t now = micros_fast();
-  
+IRAM_ATTR void EncoderBase::updateFromAB_Fast() {
+  PROFILE_BEGIN();
   // Fast GPIO read using direct register access
-  uint64_t gpio_in = GPIO.in;
-  uint8_t a = (gpio_in & ENC_PIN_A_MASK) ? 1 : 0;
-  uint8_t b = (gpio_in & ENC_PIN_B_MASK) ? 1 : 0;
-  
-  int8_t newState = (a << 1) | b;
+  decodeAB(stateFromGpio(GPIO.in), micros_fast());
+  PROFILE_END(PROF_EDGE_ISR);
+}
+
+IRAM_ATTR void EncoderBase::decodeAB(uint8_t newState, uint32_t now) {
   int idx = ((lastStateAB & 0x3) << 2) | newState;
   int8_t delta = quadTable[idx];
-  
+
+  if (quadInvalid(lastStateAB, newState)) {
+    // Both channels moved: the ISR missed an edge
+    invalidTransitions = invalidTransitions + 1;
+#if INFER_DOUBLE_STEPS
+    // Still moving (recent edge): it was two steps in the current direction
+    if ((now - lastEdgeMicros) < VELOCITY_TIMEOUT_US) {
+      delta = 2 * lastDeltaSign;
+      inferredSteps = inferredSteps + 1;
+    }
+#endif
+  }
+
   if (delta) {
-    // Glitch filter - ignore edges too close together
-    if ((now - lastEdgeMicros) >= MIN_EDGE_INTERVAL_US) {
-      positionCounts += delta;
-      edgeDeltaMicros = now - lastEdgeMicros;
+    int8_t dir = (delta > 0) ? 1 : -1;
+    uint32_t interval = now - lastEdgeMicros;
+    bool real = glitchFilter.accept(interval, dir, lastDeltaSign);
+
+    // The count always follows the AB state; a bounce back cancels itself
+    positionLock.writeBegin();
+    positionCounts += delta;
+    countCycles = ESP.getCycleCount();
+    if (real) {
+      prevEdgeMicros = lastEdgeMicros;
+      prevEdgeDeltaTicks = edgeDeltaTicks;
+      edgeDeltaTicks = interval >> (delta * dir - 1);  // Per step for inferred double steps
       lastEdgeMicros = now;
-      lastDeltaSign = (delta > 0) ? 1 : -1;
+      lastDeltaSign = dir;
+    } else {
+      // Bounce: the edge it reversed was not a real one either
+      lastEdgeMicros = prevEdgeMicros;
+      edgeDeltaTicks = prevEdgeDeltaTicks;
     }
+    positionLock.writeEnd();
+    // The bounce goes in too: a real edge, its rejected reversal and the
+    // accepted re-edge must sum to the one count they moved
+    edgeRing.push(now, delta, newState, !real);
   }
   lastStateAB = newState;
 }
 
-IRAM_ATTR void isrA() { 
-  updateFromAB_Fast(); 
+#if ISR_BACKEND != ISR_BACKEND_ARDUINO
+EncoderBase* EncoderBase::gpioEncoders[ENC_COUNT] = {};
+uint8_t EncoderBase::gpioEncoderCount = 0;
+
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+uint32_t EncoderBase::gpioIntrMask = 0;
+
+IRAM_ATTR void EncoderBase::gpioIsrHandler(void* /*arg*/) {
+  PROFILE_BEGIN();
+  uint32_t now = micros_fast();
+
+  // No peripheral-bus reads at all: clear with the known pin mask, then
+  // one CPU instruction returns every bundle level. Unchanged axes fall
+  // through decodeAB() without a count.
+  GPIO.status_w1tc = gpioIntrMask;
+  uint32_t levels = dedic_gpio_cpu_ll_read_in();
+
+  for (uint8_t i = 0; i < gpioEncoderCount; i++) {
+    EncoderBase* enc = gpioEncoders[i];
+    enc->decodeAB((levels >> enc->dedicShift) & 0x3, now);
+#if USE_INDEX
+    uint8_t z = (levels >> (enc->dedicShift + 2)) & 0x1;
+    if (z && !enc->lastZLevel) {
+      enc->onIndexPulse();
+    }
+    enc->lastZLevel = z;
+#endif
+  }
+  PROFILE_END(PROF_EDGE_ISR);
+}
+
+void EncoderBase::initDedicatedBundle() {
+  // The bundle belongs to the calling CPU; the handler is registered from the same one
+  const int pins[] = {pinB, pinA, pinZ};
+  dedic_gpio_bundle_config_t conf = {};
+  conf.gpio_array = pins;
+  conf.array_size = USE_INDEX ? 3 : 2;
+  conf.flags.in_en = 1;
+  dedic_gpio_bundle_handle_t bundle = nullptr;
+  uint32_t offset = 0;
+  dedic_gpio_new_bundle(&conf, &bundle);
+  dedic_gpio_get_in_offset(bundle, &offset);
+  dedicShift = (uint8_t)offset;
+  lastZLevel = (dedic_gpio_cpu_ll_read_in() >> (dedicShift + 2)) & 0x1;
+
+  gpioIntrMask |= (uint32_t)(pinAMask | pinBMask);
+#if USE_INDEX
+  gpioIntrMask |= BIT(pinZ);
+#endif
+  Serial.printf("Axis %u: dedicated GPIO bundle, input channels %u..%u\n", axisId,
+                (unsigned)offset, (unsigned)(offset + conf.array_size - 1));
 }
+#else
+IRAM_ATTR void EncoderBase::gpioIsrHandler(void* /*arg*/) {
+  PROFILE_BEGIN();
+  uint32_t now = micros_fast();
 
-IRAM_ATTR void isrB() { 
-  updateFromAB_Fast(); 
+  // Every GPIO interrupt in this backend is an encoder pin. Clear before
+  // reading the levels, so an edge after the read latches a new interrupt.
+  uint32_t status = GPIO.status;
+  GPIO.status_w1tc = status;
+  uint64_t gpio_in = GPIO.in;
+
+  for (uint8_t i = 0; i < gpioEncoderCount; i++) {
+    EncoderBase* enc = gpioEncoders[i];
+    if (status & (uint32_t)(enc->pinAMask | enc->pinBMask)) {
+      enc->decodeAB(enc->stateFromGpio(gpio_in), now);
+    }
+#if USE_INDEX
+    if ((status & BIT(enc->pinZ)) && (gpio_in & BIT(enc->pinZ))) {
+      enc->onIndexPulse();
+    }
+#endif
+  }
+  PROFILE_END(PROF_EDGE_ISR);
 }
+#endif
+#else
+// Shared by A and B of every axis; arg is the owning encoder
+IRAM_ATTR void EncoderBase::isrAB(void* arg) {
+  static_cast<EncoderBase*>(arg)->updateFromAB_Fast();
+}
+#endif
+
+void EncoderBase::begin() {
+  Serial.printf("Axis %u: PPR=%u, Using Optimized ISR\n", axisId, (unsigned)ppr());
 
-void initEncoder() {
-  Serial.printf("PPR=%d, Using Optimized ISR\n", ENC_PPR);
-  
   // Configure pins
-  pinMode(ENC_PIN_A, INPUT_PULLUP);
-  pinMode(ENC_PIN_B, INPUT_PULLUP);
-  
+  pinMode(pinA, INPUT_PULLUP);
+  pinMode(pinB, INPUT_PULLUP);
+
   // Initialize state with fast GPIO read
-  uint64_t gpio_in = GPIO.in;
-  uint8_t a = (gpio_in & ENC_PIN_A_MASK) ? 1 : 0;
-  uint8_t b = (gpio_in & ENC_PIN_B_MASK) ? 1 : 0;
-  lastStateAB = (a << 1) | b;
+  lastStateAB = stateFromGpio(GPIO.in);
   lastEdgeMicros = micros_fast();
 
+#if ISR_BACKEND != ISR_BACKEND_ARDUINO
+#if USE_INDEX
+  pinMode(pinZ, INPUT_PULLUP);
+#endif
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+  initDedicatedBundle();
+#endif
+
+  // Register the shared handler once, then enable this axis' pins on it
+  static bool isrRegistered = false;
+  if (!isrRegistered) {
+    gpio_isr_register(gpioIsrHandler, nullptr, ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL3, nullptr);
+    isrRegistered = true;
+  }
+  gpioEncoders[gpioEncoderCount++] = this;
+
+  gpio_set_intr_type((gpio_num_t)pinA, GPIO_INTR_ANYEDGE);
+  gpio_set_intr_type((gpio_num_t)pinB, GPIO_INTR_ANYEDGE);
+  gpio_intr_enable((gpio_num_t)pinA);
+  gpio_intr_enable((gpio_num_t)pinB);
+
+#if USE_INDEX
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+  gpio_set_intr_type((gpio_num_t)pinZ, GPIO_INTR_ANYEDGE);  // Rising edge found from lastZLevel
+#else
+  gpio_set_intr_type((gpio_num_t)pinZ, GPIO_INTR_POSEDGE);
+#endif
+  gpio_intr_enable((gpio_num_t)pinZ);
+#endif
+#else
   // Attach interrupts
-  attachInterrupt(digitalPinToInterrupt(ENC_PIN_A), isrA, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(ENC_PIN_B), isrB, CHANGE);
+  attachInterruptArg(digitalPinToInterrupt(pinA), isrAB, this, CHANGE);
+  attachInterruptArg(digitalPinToInterrupt(pinB), isrAB, this, CHANGE);
 
 #if USE_INDEX
-  pinMode(ENC_PIN_Z, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(ENC_PIN_Z), isrZ, RISING);
+  pinMode(pinZ, INPUT_PULLUP);
+  attachInterruptArg(digitalPinToInterrupt(pinZ), isrZ, this, RISING);
+#endif
 #endif
 }
 
@@ -183,138 +452,222 @@ void initEncoder() {
 
 // ====== COMMON FUNCTIONS ======
 
-IRAM_ATTR void isrZ() {
-#if USE_INDEX
-  if (digitalRead(ENC_PIN_Z)) {
-    indexFlag = true;
-    // Uncomment to auto-zero at index:
-    // positionCounts = 0;
+IRAM_ATTR int64_t EncoderBase::positionFromISR() const {
+#if USE_HARDWARE_PCNT
+  // Straight from the register: pcnt_get_counter_value() is not in IRAM.
+  // The overflow ISR may be pending behind us; apply its wrap locally.
+  uint32_t pending, count;
+  do {
+    pending = PCNT.int_raw.val & BIT(pcntUnit);
+    count = PCNT.cnt_unit[pcntUnit].val;
+  } while ((PCNT.int_raw.val & BIT(pcntUnit)) != pending);
+
+  int64_t base = pcntBaseCount;
+  if (pending) {
+    uint32_t status = PCNT.status_unit[pcntUnit].val;
+    if (status & PCNT_EVT_H_LIM) {
+      base += PCNT_H_LIM;
+    } else if (status & PCNT_EVT_L_LIM) {
+      base += PCNT_L_LIM;
+    }
   }
+  return base + (int16_t)(count & 0xFFFF);
+#else
+  return positionCounts;
 #endif
 }
 
-void updateEncoderSpeed(uint32_t currentTime) {
-  static uint32_t lastSample = 0;
-  
-  if (lastSample == 0) lastSample = currentTime;
-  
-  if ((currentTime - lastSample) >= SPEED_SAMPLE_US) {
-    int64_t pos;
-    uint32_t lastEdgeDelta;
-    int8_t deltaSign;
-    bool zSeen;
-    
-    // Atomic read of volatile variables
-    noInterrupts();
-#if USE_HARDWARE_PCNT
-    pos = readPCNTPosition();
-    // For PCNT, we don't have reliable edge timing, so use window-based only
-    lastEdgeDelta = 0;  // Force edge calculation to be disabled
-    deltaSign = 1;
+IRAM_ATTR void EncoderBase::onIndexPulse() {
+  uint32_t now = micros_fast();
+  int64_t pos = positionFromISR();
+
+  positionLock.writeBegin();
+  ZToZ z = {0, 0, false};
+  if (indexPosValid) {
+    z = checkZToZ(pos - lastIndexPos, now - latchMicros, countsPerRev, INDEX_TOLERANCE_COUNTS);
+    if (z.mismatch) indexMismatches = indexMismatches + 1;
+  }
+  lastIndexPos = pos;
+  indexPosValid = true;
+
+  latchPosition = pos - indexOffset;
+  latchMicros = now;
+  latchRevError = z.revError;
+  latchPeriodUs = z.periodUs;
+  latchCount = latchCount + 1;
+
+  if (indexZeroArmed) {
+    indexOffset = pos;
+    indexZeroArmed = (INDEX_AUTO_ZERO == 2);
+  }
+  positionLock.writeEnd();
+  indexFlag = true;
+}
+
+IRAM_ATTR void EncoderBase::isrZ(void* arg) {
+#if USE_INDEX
+  EncoderBase* enc = static_cast<EncoderBase*>(arg);
+  if (digitalRead(enc->pinZ)) {
+    enc->onIndexPulse();
+  }
 #else
-    pos = positionCounts;
-    lastEdgeDelta = edgeDeltaMicros;
-    deltaSign = lastDeltaSign;
-#endif
-    zSeen = indexFlag;
-    indexFlag = false;
-    interrupts();
-
-    // Calculate window-based speed
-    int64_t deltaCounts = pos - lastSamplePos;
-    lastSamplePos = pos;
-    float windowSec = (currentTime - lastSample) / 1e6f;
-    float cpsWindow = (windowSec > 0) ? (deltaCounts / windowSec) : 0.0f;
-
-    // Calculate signed edge-based speed
-    float cpsEdge = 0.0f;
-#if !USE_HARDWARE_PCNT
-    // Only use edge-based calculation when not using PCNT
-    if (lastEdgeDelta > 0 && (currentTime - lastEdgeMicros) < VELOCITY_TIMEOUT_US) {
-      cpsEdge = (1e6f / (float)lastEdgeDelta) * deltaSign;
-    }
+  (void)arg;
 #endif
+}
 
-    // Adaptive blending based on velocity magnitude
-    float blended;
-#if ADAPTIVE_BLENDING && !USE_HARDWARE_PCNT
-    float absWindow = abs(cpsWindow);
-    float absEdge = abs(cpsEdge);
-    
-    if (absWindow < 10.0f) {
-      // Low speed: prefer window-based
-      blended = cpsWindow;
-    } else if (absWindow > 1000.0f && absEdge > 0) {
-      // High speed: prefer edge-based
-      blended = 0.7f * cpsEdge + 0.3f * cpsWindow;
-    } else {
-      // Medium speed: balanced blend
-      blended = (cpsWindow != 0 && cpsEdge != 0) ? (0.5f * cpsWindow + 0.5f * cpsEdge)
-                                                  : (cpsWindow != 0 ? cpsWindow : cpsEdge);
-    }
+EncoderDiagnostics EncoderBase::diagnostics() const {
+  EncoderDiagnostics diag;
+  diag.invalidTransitions = invalidTransitions;
+  diag.inferredSteps = inferredSteps;
+  diag.glitches = glitchFilter.rejects();
+  diag.indexMismatches = indexMismatches;
+  return diag;
+}
+
+bool EncoderBase::setVelocityFilter(VelocityFilterType type, float param) {
+  if (!VelocityFilter::valid(type, param)) return false;
+  pendingFilterType = type;
+  pendingFilterParam = param;
+  SEQ_BARRIER();
+  filterPending = true;
+  return true;
+}
+
+bool EncoderBase::takeFilterChange(VelocityFilterType& type, float& param) {
+  if (!filterPending) return false;
+  SEQ_BARRIER();
+  type = pendingFilterType;
+  param = pendingFilterParam;
+  filterPending = false;
+  return true;
+}
+
+IndexLatch EncoderBase::indexLatch() const {
+  IndexLatch latch;
+  uint32_t seq;
+  do {
+    seq = positionLock.readBegin();
+    latch.position = latchPosition;
+    latch.micros = latchMicros;
+    latch.revError = latchRevError;
+    latch.periodUs = latchPeriodUs;
+    latch.count = latchCount;
+  } while (positionLock.readRetry(seq));
+  return latch;
+}
+
+float EncoderBase::getIndexRPM(uint32_t now) const {
+  IndexLatch latch = indexLatch();
+  return indexRpm(latch.periodUs, latch.micros, now);
+}
+
+SampleRecord EncoderBase::takeSample(uint32_t now) {
+  SampleRecord record;
+  record.timestamp = now;
+  record.position = getPosition();
+#if REPORT_PREDICTED_POS
+  record.predictedPosition = getPositionAt(now + PREDICT_AHEAD_US);
 #else
-    // When using PCNT, use only window-based calculation
-    blended = cpsWindow;
+  record.predictedPosition = (double)record.position;
 #endif
-
-#if !USE_HARDWARE_PCNT
-    // Velocity timeout - force to zero if no recent edges (ISR mode only)
-    if ((currentTime - lastEdgeMicros) > VELOCITY_TIMEOUT_US) {
-      blended = 0.0f;
-    }
+  record.countsPerSec = getCountsPerSec();
+  record.rpm = getRPM();
+#if USE_INDEX
+  record.indexRpm = getIndexRPM(now);
+#else
+  record.indexRpm = 0.0f;
 #endif
+  record.accel = getAcceleration();
+  record.jerk = getJerk();
+  record.axis = axisId;
+  record.indexSeen = takeIndexFlag();
+  record.diag = diagnostics();
+  return record;
+}
 
-    // Apply EMA filter
-    emaCountsPerSec = EMA_ALPHA * blended + (1.0f - EMA_ALPHA) * emaCountsPerSec;
-
-    lastSample = currentTime;
-  }
+void EncoderBase::armIndexZero() {
+  indexZeroArmed = true;
 }
 
-float getRPM() {
-  float revPerSec = emaCountsPerSec / (float)ENC_PPR;
-  return revPerSec * 60.0f;
+bool EncoderBase::takeIndexFlag() {
+  bool seen = indexFlag;
+  if (seen) {
+    indexFlag = false;
+  }
+  return seen;
 }
 
-float getRevolutionsPerSecond() {
-  return emaCountsPerSec / (float)ENC_PPR;
+EncoderSnapshot EncoderBase::readSnapshot() const {
+  EncoderSnapshot snap;
+#if USE_HARDWARE_PCNT
+  readWrapped(positionLock, [&] {
+    int16_t count;
+    pcnt_get_counter_value(pcntUnit, &count);
+    snap.position = pcntBaseCount + count;
+    snap.indexOffset = indexOffset;
+    snap.lastEdgeMicros = lastEdgeMicros;
+    snap.edgeDeltaTicks = edgeDeltaTicks;  // Stays 0 without MCPWM capture
+    snap.deltaSign = lastDeltaSign;
+    snap.lastEdgeTicks = lastEdgeTicks;
+    snap.rebaseGeneration = rebaseGeneration;
+    snap.rebaseShift = rebaseShift;
+  }, [this] { return pcntWrapPending(); });
+#else
+  uint32_t seq;
+  do {
+    seq = positionLock.readBegin();
+    snap.position = positionCounts;
+    snap.indexOffset = indexOffset;
+    snap.lastEdgeMicros = lastEdgeMicros;
+    snap.edgeDeltaTicks = edgeDeltaTicks;  // esp_timer µs
+    snap.deltaSign = lastDeltaSign;
+    snap.lastEdgeTicks = lastEdgeMicros;
+    snap.rebaseGeneration = rebaseGeneration;
+    snap.rebaseShift = rebaseShift;
+  } while (positionLock.readRetry(seq));
+#endif
+  return snap;
 }
 
-int64_t getPosition() {
+int64_t EncoderBase::getPosition() const {
 #if USE_HARDWARE_PCNT
   return readPCNTPosition();
 #else
   int64_t pos;
-  noInterrupts();
-  pos = positionCounts;
-  interrupts();
+  uint32_t seq;
+  do {
+    seq = positionLock.readBegin();
+    pos = positionCounts - indexOffset;
+  } while (positionLock.readRetry(seq));
   return pos;
 #endif
 }
 
-void resetPosition() {
-#if USE_HARDWARE_PCNT
-  pcnt_counter_clear(pcnt_unit);
-  pcnt_overflow_count = 0;
-#else
-  noInterrupts();
-  positionCounts = 0;
-  interrupts();
-#endif
-  lastSamplePos = 0;
+void EncoderBase::resetPosition() {
+  setPosition(0);
 }
 
-void setPosition(int64_t newPos) {
+void EncoderBase::setPosition(int64_t newPos) {
+  // Writers still mask interrupts so they cannot interleave with an ISR writer
+  noInterrupts();
+  positionLock.writeBegin();
+  // The jump goes out in the same write as the new position, so the
+  // sampler re-anchors on exactly the first snapshot that shows it
+  rebaseShift = rebaseShift + (newPos - positionFromISR());
+  rebaseGeneration = rebaseGeneration + 1;
 #if USE_HARDWARE_PCNT
-  // For PCNT, we need to calculate the equivalent counter value
-  pcnt_overflow_count = (int16_t)(newPos / (4 * 65536));
-  int16_t counterVal = (int16_t)((newPos / 4) % 65536);
-  pcnt_counter_clear(pcnt_unit);
-  // Note: Setting specific PCNT value is complex, this is a simplified version
+  // The hardware counter can only be cleared, so carry the value in the base
+  pcnt_counter_clear(pcntUnit);
+  pcntBaseCount = newPos;
+  // A wrap still pending was already folded in by positionFromISR() above.
+  // Drop its interrupt too, or the ISR would apply the latched status_unit
+  // event to the new base; with int_raw clear nothing reads that status.
+  PCNT.int_clr.val = BIT(pcntUnit);
 #else
-  noInterrupts();
   positionCounts = newPos;
-  interrupts();
 #endif
-  lastSamplePos = newPos;
+  indexOffset = 0;
+  indexPosValid = false;  // The next Z-to-Z distance would span the jump
+  positionLock.writeEnd();
+  interrupts();
 }
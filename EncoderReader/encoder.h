@@ -4,55 +4,295 @@
 #include <Arduino.h>
 #include "esp_timer.h"
 #include "config.h"
+#include "quadrature.h"
+#include "velocity.h"
+#include "glitch_filter.h"
+#include "index_check.h"
+#include "seqlock.h"
+#include "profile.h"
+#include "sample_queue.h"
+#include "capture.h"
 
-#if USE_HARDWARE_PCNT
 #include "driver/pcnt.h"
 #include "soc/gpio_struct.h"
+#if !USE_HARDWARE_PCNT
+#include "driver/gpio.h"
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+#include "driver/dedic_gpio.h"
+#include "hal/dedic_gpio_cpu_ll.h"
+#endif
+#endif
+#if USE_HARDWARE_PCNT
 #include "soc/pcnt_struct.h"
+#if USE_MCPWM_CAPTURE
+#include "driver/mcpwm.h"
 #endif
 
-// ====== ENCODER STATE ======
-extern volatile int64_t positionCounts;
-extern volatile int8_t  lastStateAB;
-extern volatile uint32_t lastEdgeMicros;
-extern volatile uint32_t edgeDeltaMicros;
-extern volatile bool indexFlag;
-extern volatile int8_t lastDeltaSign;  // Sign of last delta for signed edge speed
+// One MCPWM unit (CAP0 = A, CAP1 = B) per timestamped axis
+constexpr uint8_t MCPWM_CAPTURE_AXES = 2;
+#endif
 
-extern float emaCountsPerSec;
-extern int64_t lastSamplePos;
+// ====== UTILITY FUNCTIONS ======
+inline uint32_t micros_fast() {
+  return (uint32_t)esp_timer_get_time();
+}
 
-#if USE_HARDWARE_PCNT
-extern pcnt_unit_t pcnt_unit;
-extern int16_t pcnt_overflow_count;
+// ====== INDEX LATCH ======
+// Captured in the Z ISR at each index edge
+struct IndexLatch {
+  int64_t position;   // Reported position at the edge (before any zeroing there)
+  uint32_t micros;    // esp_timer time of the edge
+  int32_t revError;   // Z-to-Z distance minus 4*PPR (0 for the first pulse or a reversal)
+  int32_t periodUs;   // Time for the last full revolution, negative in reverse (0 = none yet)
+  uint32_t count;     // Index edges seen since boot
+};
+
+// ====== ENCODER BASE ======
+// Counting hardware of one quadrature axis. In PCNT mode each instance owns
+// one PCNT unit (the ESP32-S3 has four); in ISR mode each instance gets its
+// own A/B/Z interrupts. Velocity math lives in Encoder<Cfg> below.
+class EncoderBase {
+public:
+  EncoderBase(uint8_t axis, int pinA, int pinB, int pinZ, pcnt_unit_t unit, uint32_t countsPerRev);
+  virtual ~EncoderBase() = default;
+
+  void begin();
+
+  // ====== VELOCITY (implemented per config) ======
+  virtual void updateSpeed(uint32_t currentTime, uint32_t slackUs = 0) = 0;
+  virtual float getRPM() const = 0;
+  virtual float getRevolutionsPerSecond() const = 0;
+  virtual float getCountsPerSec() const = 0;
+  virtual float getAcceleration() const = 0;  // counts/s^2 (0 unless ESTIMATE_ACCEL)
+  virtual float getJerk() const = 0;          // counts/s^3
+  // Position (in counts, sub-count resolution) predicted to an esp_timer
+  // timestamp from the last edge, the velocity and the acceleration
+  virtual double getPositionAt(uint32_t timestampUs) const = 0;
+  virtual uint32_t ppr() const = 0;
+  virtual void setSampleWindow(uint32_t us) = 0;  // Estimation period (sampler rate)
+  virtual const VelocityFilter& velocityFilter() const = 0;
+  virtual bool velocityFiltered() const = 0;  // False: the estimator is unsmoothed
+
+  // Select the smoothing filter; false if param is out of range. Applied
+  // by the next updateSpeed(), like a position change.
+  bool setVelocityFilter(VelocityFilterType type, float param);
+
+  int64_t getPosition() const;
+  EncoderSnapshot readSnapshot() const;
+  void resetPosition();              // Reset position to zero
+  void setPosition(int64_t newPos);  // Set position to specific value
+  bool takeIndexFlag();              // Returns and clears the Z flag
+  IndexLatch indexLatch() const;     // Last Z edge
+  void armIndexZero();               // Zero at the next Z (INDEX_AUTO_ZERO 1 behaviour)
+  // RPM from the last Z-to-Z period; 0 before a full revolution or once
+  // two periods pass without an index pulse
+  float getIndexRPM(uint32_t now) const;
+  SampleRecord takeSample(uint32_t now);  // One output record; takes the Z flag
+
+  uint8_t axis() const { return axisId; }
+  pcnt_unit_t unit() const { return pcntUnit; }
+  int pinAGpio() const { return pinA; }
+  int pinBGpio() const { return pinB; }
+#if !USE_HARDWARE_PCNT
+  // CCOUNT when the ISR last applied a count (latency benchmark)
+  uint32_t lastCountCycles() const { return countCycles; }
 #endif
 
-// ====== ENCODER FUNCTIONS ======
-void initEncoder();
-void updateEncoderSpeed(uint32_t currentTime);
-float getRPM();
-float getRevolutionsPerSecond();
-int64_t getPosition();
-void resetPosition();  // Reset position to zero
-void setPosition(int64_t newPos);  // Set position to specific value
+  // Hands every queued edge to fn(const EdgeEvent&), oldest first
+  template <typename Fn>
+  void drainEdges(Fn&& fn) {
+    EdgeEvent e;
+    while (edgeRing.pop(e)) {
+      fn(e);
+    }
+  }
+  uint32_t edgeRingOverflows() const { return edgeRing.overflows(); }
+  EncoderDiagnostics diagnostics() const;
 
+  // Edge statistics of the last completed window, in edgeTickHz() ticks
+  virtual const EdgeWindowStats& edgeStats() const = 0;
+  virtual uint32_t edgeTickHz() const = 0;
+
+protected:
+  // setVelocityFilter() may run on another task than the sampler, so the
+  // change is handed over and applied by the next updateSpeed()
+  bool takeFilterChange(VelocityFilterType& type, float& param);
+
+private:
+  // ====== CONFIG ======
+  const uint8_t axisId;
+  const int pinA, pinB, pinZ;
+  const pcnt_unit_t pcntUnit;
+  const uint64_t pinAMask, pinBMask;  // Fast GPIO masks for direct register access
+  const uint32_t countsPerRev;        // 4 * PPR, for the Z-to-Z check
+
+  // ====== ISR STATE ======
+  volatile int64_t positionCounts = 0;
+  volatile int8_t  lastStateAB = 0;
+  volatile uint32_t lastEdgeMicros = 0;
+  volatile uint32_t edgeDeltaTicks = 0;   // Edge timebase: esp_timer µs (ISR) or APB ticks (MCPWM)
+  volatile bool indexFlag = false;
+  volatile int8_t lastDeltaSign = 1;  // Sign of last delta for signed edge speed
+  volatile uint32_t invalidTransitions = 0;
+  volatile uint32_t inferredSteps = 0;
+  volatile uint32_t indexMismatches = 0;
+  volatile int64_t lastIndexPos = 0;   // Continuous count at the last Z
+  volatile bool indexPosValid = false;
+  // Zeroing at index only moves this offset, so the counter (and the PCNT
+  // hardware) is never written from the ISR and no counts can be lost
+  volatile int64_t indexOffset = 0;
+  volatile bool indexZeroArmed = (INDEX_AUTO_ZERO != 0);
+  volatile int64_t latchPosition = 0;
+  volatile uint32_t latchMicros = 0;
+  volatile int32_t latchRevError = 0;
+  volatile int32_t latchPeriodUs = 0;
+  volatile uint32_t latchCount = 0;
+  volatile uint32_t rebaseGeneration = 0;  // See EncoderSnapshot
+  volatile int64_t rebaseShift = 0;
+  volatile bool filterPending = false;
+  VelocityFilterType pendingFilterType = VelocityFilterType::EMA;
+  float pendingFilterParam = 0.0f;
 #if USE_HARDWARE_PCNT
-// PCNT specific functions
-void initPCNT();
-int64_t readPCNTPosition();
-IRAM_ATTR void pcnt_overflow_handler(void* arg);
+  volatile int64_t pcntBaseCount = 0; // Counts carried over from counter overflows
+  volatile uint32_t lastEdgeTicks = 0; // MCPWM capture time of the last edge
+#endif
+  // Timing of the edge before the last one, restored when that edge turns out to be a bounce
+  volatile uint32_t prevEdgeMicros = 0;
+  volatile uint32_t prevEdgeDeltaTicks = 0;
+  GlitchFilter<GLITCH_FLOOR_US, GLITCH_CEIL_US, GLITCH_INTERVAL_SHIFT> glitchFilter;
+  // Every count change, ISR -> sampling code. The encoder instances are
+  // statics, so the ring sits in internal DRAM and is safe to touch from IRAM.
+  EdgeRing<EDGE_RING_SIZE> edgeRing;
+  SeqLock positionLock;  // Guards the ISR state above against torn reads
+
+#if USE_HARDWARE_PCNT
+  // PCNT specific functions
+  void initPCNT();
+  void configPCNTChannel(pcnt_channel_t channel, int pulsePin, int ctrlPin,
+                         const PcntChannelModel& model);
+  int64_t readPCNTPosition() const;
+  bool pcntWrapPending() const;
+  IRAM_ATTR void onPCNTOverflow(uint32_t status);
+
+  // One shared PCNT interrupt for all units, dispatched through this table
+  static EncoderBase* pcntUnits[PCNT_UNIT_MAX];
+  static IRAM_ATTR void pcnt_overflow_handler(void* arg);
+
+#if USE_MCPWM_CAPTURE
+  // Hardware edge timestamps: A and B also feed CAP0/CAP1 of MCPWM unit <axis>
+  void initCapture();
+  IRAM_ATTR void onCaptureEdge(bool isA, bool rising, uint32_t ticks);
+  static IRAM_ATTR bool captureCallback(mcpwm_unit_t mcpwm, mcpwm_capture_channel_id_t channel,
+                                        const cap_event_data_t* edata, void* arg);
+#endif
+#else
+  // ISR specific functions (optimized)
+  volatile uint32_t countCycles = 0;
+  IRAM_ATTR void updateFromAB_Fast();
+  IRAM_ATTR void decodeAB(uint8_t newState, uint32_t now);
+  inline uint8_t stateFromGpio(uint64_t gpioIn) const {
+    return ((gpioIn & pinAMask) ? 2 : 0) | ((gpioIn & pinBMask) ? 1 : 0);
+  }
+#if ISR_BACKEND != ISR_BACKEND_ARDUINO
+  // One GPIO interrupt for every encoder pin: read status and levels once
+  static EncoderBase* gpioEncoders[ENC_COUNT];
+  static uint8_t gpioEncoderCount;
+  static IRAM_ATTR void gpioIsrHandler(void* arg);
+#if ISR_BACKEND == ISR_BACKEND_DEDIC
+  // Bundle channel order B, A, Z: state = (in >> dedicShift) & 3, Z one bit above
+  uint8_t dedicShift = 0;
+  uint8_t lastZLevel = 0;
+  static uint32_t gpioIntrMask;  // Every encoder pin, cleared without reading the status
+  void initDedicatedBundle();
+#endif
 #else
-// ISR specific functions (optimized)
-IRAM_ATTR void isrA();
-IRAM_ATTR void isrB();
-IRAM_ATTR void updateFromAB_Fast();
+  static IRAM_ATTR void isrAB(void* arg);
+#endif
 #endif
 
-IRAM_ATTR void isrZ();
+  IRAM_ATTR int64_t positionFromISR() const;
+  IRAM_ATTR void onIndexPulse();
+  static IRAM_ATTR void isrZ(void* arg);
+};
 
-// ====== UTILITY FUNCTIONS ======
-inline uint32_t micros_fast() {
-  return (uint32_t)esp_timer_get_time();
-}
+// ====== ENCODER ======
+// One axis specialized at compile time by Cfg (see encoder_config.h):
+// pins, PPR, window, EMA alpha and estimator are all constexpr.
+template <typename Cfg>
+class Encoder : public EncoderBase {
+public:
+  static_assert(Cfg::pinA != Cfg::pinB, "A and B must be different pins");
+  static_assert(Cfg::pcntUnit < PCNT_UNIT_MAX, "ESP32-S3 has PCNT units 0..3");
+#if !USE_HARDWARE_PCNT && ISR_BACKEND != ISR_BACKEND_ARDUINO
+  static_assert(Cfg::pinA < 32 && Cfg::pinB < 32 && Cfg::pinZ < 32,
+                "The IDF GPIO backend only watches the GPIO0-31 interrupt status");
+#endif
+#if !USE_HARDWARE_PCNT && ISR_BACKEND == ISR_BACKEND_DEDIC
+  static_assert(ENC_COUNT * (2 + USE_INDEX) <= 8,
+                "Dedicated GPIO has 8 input channels per CPU (A, B and Z per axis)");
+#endif
+#if USE_HARDWARE_PCNT
+  static_assert(!Cfg::edgeTiming || (USE_MCPWM_CAPTURE && Cfg::axis < MCPWM_CAPTURE_AXES),
+                "PCNT edge timing needs an MCPWM capture unit (axes 0-1)");
+#endif
+
+  Encoder() : EncoderBase(Cfg::axis, Cfg::pinA, Cfg::pinB, Cfg::pinZ, (pcnt_unit_t)Cfg::pcntUnit,
+                          4 * Cfg::ppr) {}
+
+  void updateSpeed(uint32_t currentTime, uint32_t slackUs = 0) override {
+    VelocityFilterType filterType;
+    float filterParam;
+    if (takeFilterChange(filterType, filterParam)) {
+      velocity.setFilter(filterType, filterParam);
+    }
+    drainEdges([this](const EdgeEvent& e) {
+      velocity.addEdge(e);
+      if constexpr (Cfg::axis == CAPTURE_AXIS) captureEdgeEvent(e);
+    });
+    uint32_t overflows = edgeRingOverflows();
+    if (overflows != seenRingOverflows) {
+      seenRingOverflows = overflows;
+      velocity.edgesDropped();
+    }
+    velocity.update(readSnapshot(), currentTime, slackUs);
+  }
+  float getRPM() const override { return velocity.rpm(); }
+  float getRevolutionsPerSecond() const override { return velocity.revolutionsPerSec(); }
+  float getCountsPerSec() const override { return velocity.countsPerSec(); }
+  float getAcceleration() const override { return velocity.accelCountsPerSec2(); }
+  float getJerk() const override { return velocity.jerkCountsPerSec3(); }
+  double getPositionAt(uint32_t timestampUs) const override {
+    EncoderSnapshot snap = readSnapshot();
+    uint32_t now = micros_fast();
+    int64_t pos = snap.position - snap.indexOffset;
+    bool past = (int32_t)(timestampUs - now) <= 0;
+    if constexpr (Cfg::edgeTiming) {
+      // No edge between the last one and now bounds a past query to one count
+      return extrapolatePosition(pos, snap.lastEdgeMicros, snap.deltaSign,
+                                 velocity.predictionCountsPerSec(), velocity.accelCountsPerSec2(),
+                                 timestampUs, past);
+    } else {
+      // No edge times: extrapolate from the count as read now
+      return extrapolatePosition(pos, now, snap.deltaSign, velocity.predictionCountsPerSec(),
+                                 velocity.accelCountsPerSec2(), timestampUs, false);
+    }
+  }
+  uint32_t ppr() const override { return Cfg::ppr; }
+  void setSampleWindow(uint32_t us) override { velocity.setWindowUs(us); }
+  const VelocityFilter& velocityFilter() const override { return velocity.filter(); }
+  bool velocityFiltered() const override { return VelocityPipeline<Cfg>::SMOOTHED; }
+  const EdgeWindowStats& edgeStats() const override { return velocity.edgeStats(); }
+  uint32_t edgeTickHz() const override { return Cfg::edgeTickHz; }
+
+private:
+  VelocityPipeline<Cfg> velocity;
+  uint32_t seenRingOverflows = 0;
+};
+
+// ====== ENCODER INSTANCES ======
+extern EncoderBase* const encoders[ENC_COUNT];
+
+void initEncoders();
+void updateEncoderSpeeds(uint32_t currentTime, uint32_t slackUs = 0);
 
 #endif // ENCODER_H
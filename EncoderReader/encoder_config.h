@@ -0,0 +1,81 @@
+#ifndef ENCODER_CONFIG_H
+#define ENCODER_CONFIG_H
+
+#include <stdint.h>
+#include "config.h"
+#include "velocity.h"
+
+// ====== COMPILE-TIME ENCODER CONFIGS ======
+// Each axis is an Encoder<Config>; everything here is constexpr, so PPR
+// scaling folds into constants and unused estimator branches compile out.
+// The config.h macros only supply the defaults.
+
+struct EncoderConfigDefaults {
+  static constexpr uint32_t sampleUs = SPEED_SAMPLE_US;
+  static constexpr float emaAlpha = EMA_ALPHA;
+  static constexpr uint32_t timeoutUs = VELOCITY_TIMEOUT_US;
+  static constexpr VelocityEstimator estimator =
+      USE_TRACKING_OBSERVER ? VelocityEstimator::Tracking
+      : USE_EDGE_REGRESSION ? VelocityEstimator::Regression
+      : USE_MT_METHOD       ? VelocityEstimator::MT
+      : ADAPTIVE_BLENDING   ? VelocityEstimator::AdaptiveBlend
+                            : VelocityEstimator::FixedBlend;
+  static constexpr float observerTheta = OBSERVER_THETA;
+  static constexpr uint32_t regressionEdges = REGRESSION_EDGES;
+  static constexpr uint32_t regressionSpanUs = REGRESSION_SPAN_US;
+  static constexpr bool fixedPoint = USE_FIXED_POINT;
+  static constexpr bool accelEstimate = ESTIMATE_ACCEL;
+#if USE_HARDWARE_PCNT
+  // PCNT counts; edge timing comes from MCPWM capture at APB clock resolution
+  static constexpr bool edgeTiming = USE_MCPWM_CAPTURE;
+  static constexpr uint32_t edgeTickHz = 80000000;
+#else
+  // The quadrature ISR timestamps edges with esp_timer
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 1000000;
+#endif
+};
+
+// The S3 has two MCPWM units (one per axis), so in PCNT mode axes 2-3
+// fall back to window-only velocity
+struct PcntOnlyDefaults : EncoderConfigDefaults {
+  static constexpr bool edgeTiming = !USE_HARDWARE_PCNT;
+};
+
+struct Axis0Config : EncoderConfigDefaults {
+  static constexpr uint8_t axis = 0;
+  static constexpr int pinA = ENC_PIN_A;
+  static constexpr int pinB = ENC_PIN_B;
+  static constexpr int pinZ = ENC_PIN_Z;
+  static constexpr uint32_t ppr = ENC_PPR;
+  static constexpr uint8_t pcntUnit = 0;
+};
+
+struct Axis1Config : EncoderConfigDefaults {
+  static constexpr uint8_t axis = 1;
+  static constexpr int pinA = ENC1_PIN_A;
+  static constexpr int pinB = ENC1_PIN_B;
+  static constexpr int pinZ = ENC1_PIN_Z;
+  static constexpr uint32_t ppr = ENC1_PPR;
+  static constexpr uint8_t pcntUnit = 1;
+};
+
+struct Axis2Config : PcntOnlyDefaults {
+  static constexpr uint8_t axis = 2;
+  static constexpr int pinA = ENC2_PIN_A;
+  static constexpr int pinB = ENC2_PIN_B;
+  static constexpr int pinZ = ENC2_PIN_Z;
+  static constexpr uint32_t ppr = ENC2_PPR;
+  static constexpr uint8_t pcntUnit = 2;
+};
+
+struct Axis3Config : PcntOnlyDefaults {
+  static constexpr uint8_t axis = 3;
+  static constexpr int pinA = ENC3_PIN_A;
+  static constexpr int pinB = ENC3_PIN_B;
+  static constexpr int pinZ = ENC3_PIN_Z;
+  static constexpr uint32_t ppr = ENC3_PPR;
+  static constexpr uint8_t pcntUnit = 3;
+};
+
+#endif // ENCODER_CONFIG_H
@@ -0,0 +1,47 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+// ====== Q16 FIXED POINT ======
+// Velocities in counts/s with 16 fractional bits, held in int64_t so the
+// integer part covers any realistic count rate (Q47.16). Multiplies are
+// 32x32->64 on Xtensa; the only divisions left are 32-bit (hardware QUOU).
+typedef int64_t q16_t;
+
+constexpr int Q16_SHIFT = 16;
+constexpr q16_t Q16_ONE = (q16_t)1 << Q16_SHIFT;
+
+// Compile-time conversion of float constants (gains, thresholds)
+constexpr q16_t toQ16(float value) {
+  return (q16_t)(value * (float)Q16_ONE + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+constexpr float Q16_TO_FLOAT = 1.0f / (float)Q16_ONE;
+
+inline float q16ToFloat(q16_t value) {
+  return (float)value * Q16_TO_FLOAT;
+}
+
+// Gains in [0, 1] (EMA alpha, blend weights) carry 20 fractional bits: in
+// Q16 alpha = 0.4 is already off by 1.5e-5, and that error shows in full
+// in the estimate. Value x gain stays within 64 bits up to 2^27 counts/s.
+typedef int64_t gain_t;
+
+constexpr int GAIN_SHIFT = 20;
+
+constexpr gain_t toGain(float value) {
+  return (gain_t)(value * (float)((gain_t)1 << GAIN_SHIFT) + 0.5f);
+}
+
+// (a * b) for a Q16 value and a gain, rounded to nearest: a truncating
+// shift would leave the EMA short of a constant input
+inline q16_t mulQ16(q16_t value, gain_t gain) {
+  return (value * gain + ((gain_t)1 << (GAIN_SHIFT - 1))) >> GAIN_SHIFT;
+}
+
+inline q16_t absQ16(q16_t value) {
+  return value < 0 ? -value : value;
+}
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,53 @@
+#ifndef GLITCH_FILTER_H
+#define GLITCH_FILTER_H
+
+#include <stdint.h>
+
+// ====== ADAPTIVE GLITCH FILTER ======
+// Hardware independent. A contact bounce shows up as an edge that reverses
+// the previous one (A/B toggling back) much sooner than the encoder could
+// really turn around. Edges that continue in the same direction are always
+// accepted, so there is no speed cap. Only a reversal that arrives within a
+// fraction of the recent edge interval is classified as a glitch. That
+// threshold follows the speed and stays within [floorUs, ceilUs].
+//
+// A glitch still changes the count (the AB state did change, and the edge
+// that follows it cancels it). It also goes into the edge ring, flagged, so
+// the ring deltas keep summing to the count; it is only kept out of edge
+// timing.
+template <uint32_t floorUs, uint32_t ceilUs, uint8_t intervalShift>
+class GlitchFilter {
+public:
+  static_assert(floorUs <= ceilUs, "Glitch filter floor must not exceed its ceiling");
+
+  // interval: time since the last accepted edge; delta / lastDelta: +1 or -1.
+  // Returns true for a real edge, false for a glitch (counted).
+  inline __attribute__((always_inline)) bool accept(uint32_t interval, int8_t delta,
+                                                    int8_t lastDelta) {
+    if (delta == lastDelta) {
+      // Smoothed edge interval (1/4 step), the speed estimate for the threshold
+      intervalEst = (uint32_t)((int32_t)intervalEst +
+                               (((int32_t)interval - (int32_t)intervalEst) >> 2));
+      return true;
+    }
+    if (interval < threshold()) {
+      rejectCount = rejectCount + 1;
+      return false;
+    }
+    intervalEst = interval;  // Genuine reversal: restart from the slow interval
+    return true;
+  }
+
+  uint32_t threshold() const {
+    uint32_t t = intervalEst >> intervalShift;
+    return t < floorUs ? floorUs : (t > ceilUs ? ceilUs : t);
+  }
+
+  uint32_t rejects() const { return rejectCount; }
+
+private:
+  uint32_t intervalEst = ceilUs << intervalShift;  // Start at the widest threshold
+  volatile uint32_t rejectCount = 0;
+};
+
+#endif // GLITCH_FILTER_H
@@ -0,0 +1,50 @@
+#ifndef INDEX_CHECK_H
+#define INDEX_CHECK_H
+
+#include <stdint.h>
+
+// ====== Z-TO-Z CHECK ======
+// Hardware independent part of the index ISR and of getIndexRPM(), so
+// test/test_index_period runs the same code on simulated Z traces.
+//
+// Consecutive Z pulses must be one revolution apart, or at the same place
+// after a reversal; both within tolerance counts (the Z pulse width).
+// Anything else means counts were lost or gained.
+struct ZToZ {
+  int32_t revError;  // Distance minus countsPerRev (0 for a reversal at the same place)
+  int32_t periodUs;  // Time of a clean revolution, negative in reverse (0 = none)
+  bool mismatch;     // Neither a revolution nor a reversal
+};
+
+// signedDist: position now minus at the previous Z; elapsedUs: time since it
+inline __attribute__((always_inline)) ZToZ checkZToZ(int64_t signedDist, uint32_t elapsedUs,
+                                                     uint32_t countsPerRev, uint32_t tolerance) {
+  ZToZ z = {0, 0, false};
+  int64_t dist = (signedDist < 0) ? -signedDist : signedDist;
+  int64_t offRev = dist - (int64_t)countsPerRev;
+  bool samePlace = dist <= (int64_t)tolerance;
+  if (!samePlace) {
+    z.revError = (int32_t)offRev;
+  }
+  if (offRev < 0) offRev = -offRev;
+  if (offRev <= (int64_t)tolerance) {
+    // A clean revolution: the time since the previous Z is its period
+    z.periodUs = (int32_t)elapsedUs;
+    if (signedDist < 0) z.periodUs = -z.periodUs;
+  } else if (!samePlace) {
+    z.mismatch = true;
+  }
+  return z;
+}
+
+// RPM from the last revolution period; 0 before a full revolution or once
+// two periods pass without a Z. Signed time since the latch: a latch taken
+// just after `now` was sampled is not a stop.
+inline float indexRpm(int32_t periodUs, uint32_t latchMicros, uint32_t now) {
+  if (periodUs == 0) return 0.0f;
+  uint32_t period = (periodUs < 0) ? (uint32_t)-periodUs : (uint32_t)periodUs;
+  if ((int32_t)(now - latchMicros) > (int32_t)(2 * period)) return 0.0f;  // Slowed down or stopped
+  return 60e6f / (float)periodUs;
+}
+
+#endif // INDEX_CHECK_H
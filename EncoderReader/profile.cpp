@@ -0,0 +1,33 @@
+#include "profile.h"
+
+ProfileStats profileStats[PROF_POINT_COUNT];
+
+static const char* const PROFILE_NAMES[PROF_POINT_COUNT] = {
+  "edgeIsr", "pcntIsr", "updateSpeed", "print"
+};
+
+void printProfile() {
+#if USE_PROFILING
+  float usPerCycle = 1.0f / (float)ESP.getCpuFreqMHz();
+  for (uint8_t p = 0; p < PROF_POINT_COUNT; p++) {
+    const ProfileStats& s = profileStats[p];
+    Serial.printf("PROFILE %s n=%u max=%u cycles (%.2fus)", PROFILE_NAMES[p], (unsigned)s.count,
+                  (unsigned)s.maxCycles, s.maxCycles * usPerCycle);
+    // Only the populated buckets, as 2^k=<count>
+    for (uint8_t k = 0; k < PROFILE_BUCKETS; k++) {
+      if (s.buckets[k]) {
+        Serial.printf(" 2^%u=%u", k, (unsigned)s.buckets[k]);
+      }
+    }
+    Serial.println();
+  }
+#else
+  Serial.println(F("Profiling disabled (USE_PROFILING=0)"));
+#endif
+}
+
+void resetProfile() {
+  // Racy against the writers, which at worst keeps one sample of the old run
+  memset(profileStats, 0, sizeof(profileStats));
+  Serial.println(F("Profile histograms reset"));
+}
@@ -0,0 +1,48 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ====== CYCLE PROFILER ======
+// CCOUNT at entry/exit of the hot paths, folded into log2 histograms
+// (bucket k holds durations in [2^k, 2^(k+1)) cycles). Each point has a
+// single writer (one ISR or one task), so recording is lock-free: a
+// subtract, NSAU for the bucket, two increments and a compare.
+enum ProfilePoint : uint8_t {
+  PROF_EDGE_ISR,      // A/B edge handler (ISR decoder or MCPWM capture)
+  PROF_PCNT_ISR,      // pcnt_overflow_handler()
+  PROF_UPDATE_SPEED,  // updateEncoderSpeeds(), all axes
+  PROF_PRINT,         // printEncoderData(), one line
+  PROF_POINT_COUNT
+};
+
+constexpr uint8_t PROFILE_BUCKETS = 32;
+
+struct ProfileStats {
+  uint32_t count;
+  uint32_t maxCycles;
+  uint32_t buckets[PROFILE_BUCKETS];
+};
+
+extern ProfileStats profileStats[PROF_POINT_COUNT];
+
+inline __attribute__((always_inline)) void profileRecord(ProfilePoint point, uint32_t cycles) {
+  ProfileStats& s = profileStats[point];
+  s.count++;
+  if (cycles > s.maxCycles) s.maxCycles = cycles;
+  s.buckets[31 - __builtin_clz(cycles | 1)]++;
+}
+
+#if USE_PROFILING
+#define PROFILE_BEGIN() uint32_t profileStart_ = ESP.getCycleCount()
+#define PROFILE_END(point) profileRecord(point, ESP.getCycleCount() - profileStart_)
+#else
+#define PROFILE_BEGIN()
+#define PROFILE_END(point)
+#endif
+
+void printProfile();
+void resetProfile();
+
+#endif // PROFILE_H
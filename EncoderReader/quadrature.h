@@ -0,0 +1,105 @@
+#ifndef QUADRATURE_H
+#define QUADRATURE_H
+
+#include <stdint.h>
+
+// ====== QUADRATURE DECODER MODEL ======
+// Hardware independent: shared by the ISR decoder and used to verify the
+// PCNT channel setup at compile time. States: A=(bit1), B=(bit0)
+
+// Transition table for quadrature (old<<2 | new) -> delta
+constexpr int8_t quadTable[16] = {
+  0,  // 0000 (00->00)
+  +1, // 0001 (00->01)
+  -1, // 0010 (00->10)
+  0,  // 0011 (00->11 invalid skip)
+  -1, // 0100 (01->00)
+  0,  // 0101 (01->01)
+  0,  // 0110 (01->10 invalid)
+  +1, // 0111 (01->11)
+  +1, // 1000 (10->00)
+  0,  // 1001 (10->01 invalid)
+  0,  // 1010 (10->10)
+  -1, // 1011 (10->11)
+  0,  // 1100 (11->00 invalid)
+  -1, // 1101 (11->01)
+  +1, // 1110 (11->10)
+  0   // 1111 (11->11)
+};
+
+constexpr int8_t quadDelta(uint8_t oldAB, uint8_t newAB) {
+  return quadTable[((oldAB & 0x3) << 2) | (newAB & 0x3)];
+}
+
+// Both bits changed at once (the 0 entries above that are not "no change"):
+// an edge was missed, so the direction of the step is unknown
+constexpr bool quadInvalid(uint8_t oldAB, uint8_t newAB) {
+  return ((oldAB ^ newAB) & 0x3) == 0x3;
+}
+
+// ====== DECODER DIAGNOSTICS ======
+// Per-encoder error counters, cumulative since boot
+struct EncoderDiagnostics {
+  uint32_t invalidTransitions;  // Double steps seen by the decoder (ISR / capture)
+  uint32_t inferredSteps;       // Double steps counted as 2 in the current direction
+  uint32_t glitches;            // Bounces rejected by the glitch filter
+  uint32_t indexMismatches;     // Z pulses not 4*PPR counts after the previous one
+};
+
+// ====== PCNT CHANNEL MODEL ======
+// Mirrors pcnt_count_mode_t / pcnt_ctrl_mode_t: what one PCNT channel does
+// on an edge of its pulse input, given the level of its control input.
+enum class PcntEdgeAction : int8_t { Disable = 0, Inc = 1, Dec = -1 };
+enum class PcntCtrlAction : int8_t { Disable = 0, Keep = 1, Reverse = -1 };
+
+struct PcntChannelModel {
+  PcntEdgeAction pos;    // pulse input rising
+  PcntEdgeAction neg;    // pulse input falling
+  PcntCtrlAction lctrl;  // control input low
+  PcntCtrlAction hctrl;  // control input high
+};
+
+// X4 decoding: both channels count both edges of their pulse input
+// Channel 0: pulse = A, control = B
+constexpr PcntChannelModel PCNT_CH_A = {
+  PcntEdgeAction::Inc, PcntEdgeAction::Dec, PcntCtrlAction::Reverse, PcntCtrlAction::Keep
+};
+// Channel 1: pulse = B, control = A
+constexpr PcntChannelModel PCNT_CH_B = {
+  PcntEdgeAction::Inc, PcntEdgeAction::Dec, PcntCtrlAction::Keep, PcntCtrlAction::Reverse
+};
+
+constexpr int8_t pcntChannelDelta(const PcntChannelModel& ch, uint8_t oldPulse,
+                                  uint8_t newPulse, uint8_t ctrl) {
+  if (oldPulse == newPulse) return 0;
+  int8_t edge = (int8_t)(newPulse ? ch.pos : ch.neg);
+  int8_t mode = (int8_t)(ctrl ? ch.hctrl : ch.lctrl);
+  return (int8_t)(edge * mode);
+}
+
+// Count change the PCNT unit produces for one AB transition. The hardware
+// sees one pin change at a time; a simultaneous A+B change is ambiguous, so
+// (like quadTable) it is modelled as no count.
+constexpr int8_t pcntModelDelta(uint8_t oldAB, uint8_t newAB) {
+  uint8_t oldA = (oldAB >> 1) & 1, oldB = oldAB & 1;
+  uint8_t newA = (newAB >> 1) & 1, newB = newAB & 1;
+  if (oldA != newA && oldB != newB) return 0;
+  return (int8_t)(pcntChannelDelta(PCNT_CH_A, oldA, newA, oldB) +
+                  pcntChannelDelta(PCNT_CH_B, oldB, newB, oldA));
+}
+
+// Edge-for-edge check: every transition gives the same count in PCNT and ISR mode
+constexpr bool pcntModelMatchesQuadTable() {
+  for (uint8_t idx = 0; idx < 16; idx++) {
+    if (pcntModelDelta(idx >> 2, idx & 0x3) != quadTable[idx]) return false;
+  }
+  return true;
+}
+
+static_assert(pcntModelMatchesQuadTable(), "PCNT channel setup disagrees with quadTable");
+
+// One full forward cycle (00->01->11->10->00) must advance exactly 4 counts
+static_assert(pcntModelDelta(0, 1) + pcntModelDelta(1, 3) + pcntModelDelta(3, 2) +
+              pcntModelDelta(2, 0) == 4, "PCNT model is not X4");
+
+#endif // QUADRATURE_H
@@ -0,0 +1,94 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <stdint.h>
+
+// ====== SLIDING EDGE REGRESSION ======
+// Least-squares line through the last N (edge ticks, cumulative count)
+// pairs. The sums are kept exactly in 64-bit integers relative to the
+// oldest point, so adding or dropping an edge is O(1) and never drifts:
+// when the oldest point leaves, the sums are shifted onto the next one.
+// Points more than LimitTicks apart are never held together, which bounds
+// the sums (t^2 * N^2 < 2^63).
+template <uint32_t N, uint32_t LimitTicks>
+class EdgeRegression {
+public:
+  static_assert(N >= 2 && N <= 32, "Regression window must be 2..32 edges");
+  static_assert(LimitTicks < (1u << 26), "Regression span too long for 64-bit sums");
+
+  void add(uint32_t ticks, int32_t count) {
+    while (used > 0 && ticks - points[first].ticks > LimitTicks) removeOldest();
+    if (used == N) removeOldest();
+    if (used == 0) {
+      baseTicks = ticks;
+      baseCount = count;
+    }
+    int64_t t = (int64_t)(ticks - baseTicks);
+    int64_t x = (int64_t)(count - baseCount);
+    sumT += t;
+    sumX += x;
+    sumTT += t * t;
+    sumTX += t * x;
+    points[(first + used) % N] = {ticks, count};
+    used++;
+  }
+
+  // Drop points older than spanTicks before the newest, keeping the last
+  // two so a slow shaft still has an edge interval to fit
+  void trim(uint32_t spanTicks) {
+    while (used > 2 && newestTicks() - points[first].ticks > spanTicks) removeOldest();
+  }
+
+  void clear() {
+    used = 0;
+    sumT = sumX = sumTT = sumTX = 0;
+  }
+
+  uint32_t size() const { return used; }
+  uint32_t newestTicks() const { return points[(first + used - 1) % N].ticks; }
+
+  // Fitted counts per tick; false until two distinct timestamps are held
+  bool slope(float& countsPerTick) const {
+    if (used < 2) return false;
+    int64_t n = used;
+    int64_t den = n * sumTT - sumT * sumT;
+    if (den <= 0) return false;
+    countsPerTick = (float)(n * sumTX - sumT * sumX) / (float)den;
+    return true;
+  }
+
+private:
+  struct Point {
+    uint32_t ticks;
+    int32_t count;
+  };
+
+  Point points[N];
+  uint32_t first = 0;
+  uint32_t used = 0;
+  uint32_t baseTicks = 0;  // Oldest point; all sums are relative to it
+  int32_t baseCount = 0;
+  int64_t sumT = 0, sumX = 0, sumTT = 0, sumTX = 0;
+
+  // The oldest point is the origin, so it contributes nothing to the sums;
+  // dropping it only moves the origin to the next point
+  void removeOldest() {
+    first = (first + 1) % N;
+    used--;
+    if (used == 0) {
+      clear();
+      return;
+    }
+    int64_t n = used;
+    int64_t d = (int64_t)(points[first].ticks - baseTicks);
+    int64_t e = (int64_t)(points[first].count - baseCount);
+    sumTT += n * d * d - 2 * d * sumT;
+    sumTX += n * d * e - e * sumT - d * sumX;
+    sumT -= n * d;
+    sumX -= n * e;
+    baseTicks = points[first].ticks;
+    baseCount = points[first].count;
+  }
+};
+
+#endif // REGRESSION_H
@@ -0,0 +1,68 @@
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <stdint.h>
+#include "quadrature.h"
+
+// ====== SAMPLE RECORD ======
+// One per axis per sampling period, produced by the acquisition task
+struct SampleRecord {
+  uint32_t timestamp;     // micros_fast() at the sampling wake
+  int64_t position;
+  double predictedPosition;  // getPositionAt(timestamp + PREDICT_AHEAD_US)
+  float countsPerSec;
+  float rpm;
+  float indexRpm;         // From the last Z-to-Z period (USE_INDEX), 0 when unknown
+  float accel;            // counts/s^2
+  float jerk;             // counts/s^3
+  uint8_t axis;
+  uint8_t indexSeen;      // Z seen since the previous record of this axis
+  EncoderDiagnostics diag;
+};
+
+// ====== LOCK-FREE SAMPLE QUEUE ======
+// Single producer (acquisition task) / single consumer (telemetry loop),
+// same free-running index scheme as EdgeRing. A full queue drops the new
+// record so a stalled Serial port never blocks acquisition.
+template <uint32_t N>
+class SampleQueue {
+public:
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Sample queue size must be a power of two");
+
+  bool push(const SampleRecord& record) {
+    uint32_t h = head;
+    uint32_t depth = h - tail;
+    if (depth >= N) {
+      dropCount = dropCount + 1;
+      return false;
+    }
+    buffer[h & (N - 1)] = record;
+    __sync_synchronize();  // Publish the record before the index
+    head = h + 1;
+    if (depth + 1 > highWater) highWater = depth + 1;
+    return true;
+  }
+
+  bool pop(SampleRecord& out) {
+    uint32_t t = tail;
+    if (t == head) return false;
+    __sync_synchronize();  // Read the record only after seeing the index
+    out = buffer[t & (N - 1)];
+    __sync_synchronize();
+    tail = t + 1;
+    return true;
+  }
+
+  uint32_t size() const { return head - tail; }
+  uint32_t highWaterMark() const { return highWater; }
+  uint32_t drops() const { return dropCount; }
+
+private:
+  SampleRecord buffer[N];
+  volatile uint32_t head = 0;
+  volatile uint32_t tail = 0;
+  volatile uint32_t highWater = 0;
+  volatile uint32_t dropCount = 0;
+};
+
+#endif // SAMPLE_QUEUE_H
@@ -0,0 +1,200 @@
+#include "sampler.h"
+#include "encoder.h"
+#include "decimator.h"
+#include "burst.h"
+#include <esp_timer.h>
+#include <esp_task.h>
+
+// The esp_timer task only notifies the sampler; above it, a slow update
+// would delay every other esp_timer callback
+static_assert(SAMPLER_PRIORITY < ESP_TASK_TIMER_PRIO, "Sampler must run below the esp_timer task");
+
+// Deviation histogram, 1 µs bins; the last bin collects everything larger
+#define JITTER_HIST_BINS 256
+
+static TaskHandle_t samplerTask = nullptr;
+static esp_timer_handle_t samplerTimer = nullptr;
+static SampleQueue<SAMPLE_QUEUE_SIZE> sampleQueue;
+
+// Written by the sampling task only
+static uint32_t jitterHist[JITTER_HIST_BINS];
+static volatile uint32_t timingSamples = 0;
+static volatile uint32_t minPeriodUs = UINT32_MAX;
+static volatile uint32_t maxPeriodUs = 0;
+static volatile bool timingResetRequested = false;
+
+// Current rates, and a change requested by setSamplerRates()
+static volatile uint32_t samplePeriodUs = SPEED_SAMPLE_US;
+static volatile uint32_t outputDecimation = OUTPUT_DECIMATION;
+static volatile uint32_t requestedPeriodUs = 0;
+static volatile uint32_t requestedDecimation = 0;
+static volatile bool rateChangeRequested = false;
+
+// Per-axis decimators between the estimation and output rates
+struct OutputDecimator {
+  CicDecimator cps;
+  CicDecimator accel;
+  CicDecimator jerk;
+};
+static OutputDecimator outputs[ENC_COUNT];
+static_assert(OUTPUT_DECIMATION >= 1 && OUTPUT_DECIMATION <= CicDecimator::MAX_RATIO,
+              "OUTPUT_DECIMATION must be 1..256");
+
+static void recordPeriod(uint32_t periodUs) {
+  if (timingResetRequested) {
+    memset(jitterHist, 0, sizeof(jitterHist));
+    timingSamples = 0;
+    minPeriodUs = UINT32_MAX;
+    maxPeriodUs = 0;
+    timingResetRequested = false;
+  }
+
+  uint32_t nominal = samplePeriodUs;
+  uint32_t deviation = (periodUs > nominal) ? (periodUs - nominal) : (nominal - periodUs);
+  if (deviation >= JITTER_HIST_BINS) deviation = JITTER_HIST_BINS - 1;
+  jitterHist[deviation]++;
+
+  if (periodUs < minPeriodUs) minPeriodUs = periodUs;
+  if (periodUs > maxPeriodUs) maxPeriodUs = periodUs;
+  timingSamples = timingSamples + 1;
+}
+
+// esp_timer task context: just wake the sampler
+static void samplerTimerCallback(void* /*arg*/) {
+  xTaskNotifyGive(samplerTask);
+}
+
+// Sampler task only: new window length, fresh filters and timing stats
+static void applyRates(uint32_t periodUs, uint32_t decimation) {
+  samplePeriodUs = periodUs;
+  outputDecimation = decimation;
+  for (EncoderBase* enc : encoders) {
+    enc->setSampleWindow(periodUs);
+  }
+  for (OutputDecimator& out : outputs) {
+    out.cps.configure(decimation);
+    out.accel.configure(decimation);
+    out.jerk.configure(decimation);
+  }
+  timingResetRequested = true;
+}
+
+static void samplerTaskMain(void* /*arg*/) {
+  uint32_t lastWake = 0;
+  applyRates(samplePeriodUs, outputDecimation);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t now = micros_fast();
+
+    if (rateChangeRequested) {
+      applyRates(requestedPeriodUs, requestedDecimation);
+      esp_timer_stop(samplerTimer);
+      esp_timer_start_periodic(samplerTimer, samplePeriodUs);
+      rateChangeRequested = false;
+      lastWake = 0;
+    }
+
+    if (lastWake != 0) {
+      recordPeriod(now - lastWake);
+    }
+    lastWake = now;
+
+    // Every wake is a window boundary; half a period of slack absorbs jitter
+    updateEncoderSpeeds(now, samplePeriodUs / 2);
+    burstRecord(now);
+
+    // The three decimators of an axis share a phase, so they complete together
+    for (int i = 0; i < ENC_COUNT; i++) {
+      EncoderBase* enc = encoders[i];
+      OutputDecimator& out = outputs[i];
+      float cps, accel, jerk;
+      bool ready = out.cps.push(enc->getCountsPerSec(), cps);
+      out.accel.push(enc->getAcceleration(), accel);
+      out.jerk.push(enc->getJerk(), jerk);
+      if (ready) {
+        SampleRecord record = enc->takeSample(now);
+        record.countsPerSec = cps;
+        record.rpm = cps * 60.0f / (4.0f * enc->ppr());
+        record.accel = accel;
+        record.jerk = jerk;
+        sampleQueue.push(record);
+      }
+    }
+  }
+}
+
+void initSampler() {
+  xTaskCreatePinnedToCore(samplerTaskMain, "sampler", 4096, nullptr,
+                          SAMPLER_PRIORITY, &samplerTask, SAMPLER_CORE);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = samplerTimerCallback;
+  timerArgs.name = "sampler";
+  esp_timer_create(&timerArgs, &samplerTimer);
+  esp_timer_start_periodic(samplerTimer, SPEED_SAMPLE_US);
+
+  Serial.printf("Sampler: esp_timer %dus -> task on core %d (prio %d), output every %d\n",
+                SPEED_SAMPLE_US, SAMPLER_CORE, SAMPLER_PRIORITY, OUTPUT_DECIMATION);
+}
+
+bool setSamplerRates(uint32_t estimateHz, uint32_t outputHz) {
+  if (estimateHz == 0 || outputHz == 0 || outputHz > estimateHz ||
+      estimateHz > 1000000 / MIN_SAMPLE_US) {
+    return false;
+  }
+  uint32_t decimation = (estimateHz + outputHz / 2) / outputHz;
+  if (decimation > CicDecimator::MAX_RATIO) return false;
+
+  requestedPeriodUs = 1000000 / estimateHz;
+  requestedDecimation = decimation;
+  __sync_synchronize();  // Publish the rates before the flag
+  rateChangeRequested = true;
+  return true;
+}
+
+void getSamplerRates(uint32_t& periodUs, uint32_t& decimation, bool requested) {
+  bool pending = requested && rateChangeRequested;
+  periodUs = pending ? requestedPeriodUs : samplePeriodUs;
+  decimation = pending ? requestedDecimation : outputDecimation;
+}
+
+SamplerTiming getSamplerTiming() {
+  SamplerTiming timing;
+  timing.samples = timingSamples;
+  timing.minPeriodUs = (timing.samples > 0) ? minPeriodUs : 0;
+  timing.maxPeriodUs = maxPeriodUs;
+  timing.nominalPeriodUs = samplePeriodUs;
+
+  // Walk the histogram up to 99% of the samples (a racy but harmless read)
+  uint32_t target = timing.samples - timing.samples / 100;
+  uint32_t seen = 0;
+  timing.p99DeviationUs = 0;
+  for (uint32_t bin = 0; bin < JITTER_HIST_BINS; bin++) {
+    seen += jitterHist[bin];
+    if (seen >= target) {
+      timing.p99DeviationUs = bin;
+      break;
+    }
+  }
+  return timing;
+}
+
+void resetSamplerTiming() {
+  timingResetRequested = true;
+}
+
+bool popSample(SampleRecord& out) {
+  return sampleQueue.pop(out);
+}
+
+uint32_t sampleQueueDepth() {
+  return sampleQueue.size();
+}
+
+uint32_t sampleQueueHighWater() {
+  return sampleQueue.highWaterMark();
+}
+
+uint32_t sampleQueueDrops() {
+  return sampleQueue.drops();
+}
@@ -0,0 +1,44 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sample_queue.h"
+
+// ====== SAMPLING TASK ======
+// A periodic esp_timer wakes a high-priority task pinned to SAMPLER_CORE,
+// which runs updateEncoderSpeeds() every estimation period (SPEED_SAMPLE_US
+// at boot) and queues one SampleRecord per axis every OUTPUT_DECIMATION
+// periods, with speed, acceleration and jerk CIC-decimated in between.
+// loop() on the other core drains the queue and owns Serial, so a slow
+// printf can only fill the queue, never delay a sample.
+
+// Measured wake-to-wake period of the sampling task
+struct SamplerTiming {
+  uint32_t samples;
+  uint32_t minPeriodUs;
+  uint32_t maxPeriodUs;
+  uint32_t p99DeviationUs;  // 99th percentile of |period - nominal period|
+  uint32_t nominalPeriodUs;
+};
+
+void initSampler();
+SamplerTiming getSamplerTiming();
+void resetSamplerTiming();  // Applied by the task on its next wake
+
+// Estimation and output rates. estimateHz must be 1..1e6/MIN_SAMPLE_US;
+// outputHz is rounded to estimateHz / an integer decimation of
+// 1..CicDecimator::MAX_RATIO.
+// Returns false for rates out of range. Applied by the task on its next
+// wake, which also resets the filters and the timing stats.
+bool setSamplerRates(uint32_t estimateHz, uint32_t outputHz);
+// requested: report a change that is still waiting to be applied
+void getSamplerRates(uint32_t& periodUs, uint32_t& decimation, bool requested = false);
+
+// Telemetry side of the sample queue
+bool popSample(SampleRecord& out);
+uint32_t sampleQueueDepth();
+uint32_t sampleQueueHighWater();
+uint32_t sampleQueueDrops();
+
+#endif // SAMPLER_H
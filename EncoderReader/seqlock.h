@@ -0,0 +1,68 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+
+// memw on Xtensa; orders the generation against the protected data
+#define SEQ_BARRIER() __sync_synchronize()
+
+// ====== SEQLOCK ======
+// Writers (ISRs) bump the generation to odd, update, then bump it back to
+// even. Readers retry until they see the same even value before and after
+// their copy, so they never need noInterrupts(). Inlined so the ISR side
+// stays in IRAM.
+class SeqLock {
+public:
+  inline __attribute__((always_inline)) void writeBegin() {
+    seq = seq + 1;
+    SEQ_BARRIER();
+  }
+
+  inline __attribute__((always_inline)) void writeEnd() {
+    SEQ_BARRIER();
+    seq = seq + 1;
+  }
+
+  uint32_t readBegin() const {
+    uint32_t s;
+    do {
+      s = seq;  // Odd only while an ISR on the other core is writing
+    } while (s & 1);
+    SEQ_BARRIER();
+    return s;
+  }
+
+  bool readRetry(uint32_t s) const {
+    SEQ_BARRIER();
+    return seq != s;
+  }
+
+private:
+  volatile uint32_t seq = 0;
+};
+
+// ====== WRAPPED COUNTER READ ======
+// Hardware independent read side of an extended hardware counter (PCNT).
+// The counter resets to 0 at its limit and raises its interrupt; the
+// overflow ISR then adds the limit to the 64-bit base under the seqlock and
+// clears the interrupt only after that. So besides the seqlock retry, a
+// reader also retries while the interrupt is raw-pending: the counter has
+// already wrapped but the base does not include it yet.
+//
+// copy() reads the base, the counter and anything else the caller needs,
+// wrapPending() the raw interrupt bit. The lock, the copy and the pending
+// check are all passed in, so test/test_pcnt_read runs this exact loop
+// against a model that wraps the counter or runs the ISR between any two
+// of its accesses.
+template <typename Lock, typename Copy, typename WrapPending>
+inline void readWrapped(const Lock& lock, Copy copy, WrapPending wrapPending) {
+  uint32_t s;
+  bool pending;
+  do {
+    s = lock.readBegin();
+    copy();
+    pending = wrapPending();
+  } while (pending || lock.readRetry(s));
+}
+
+#endif // SEQLOCK_H
@@ -0,0 +1,316 @@
+#ifndef TRACE_SIM_H
+#define TRACE_SIM_H
+
+#include <stdint.h>
+#include <math.h>
+#include "edge_ring.h"
+#include "velocity.h"
+
+// ====== SYNTHETIC ENCODER TRACES ======
+// Hardware independent edge traces run through VelocityPipeline. BENCH
+// prints their figures on the device (next to cycle counts), test/ asserts
+// them on the host, so both run exactly the same trace.
+
+// ====== CONSTANT SPEED ======
+// Edge timestamps with a 5% quadrature phase error (alternate edges
+// early/late) and +-0.5 us capture jitter, pushed into an edge ring that is
+// drained once per window, as updateSpeed() does. Rings smaller than the
+// edges per window overflow at the top speeds.
+constexpr uint32_t SPEED_TRACE_WINDOWS = 200;
+constexpr uint32_t SPEED_TRACE_WARMUP = 20;
+
+struct SpeedTraceResult {
+  float rmsPct;          // RMS error of the estimate relative to the true speed
+  uint32_t drained;      // Edges taken out of the ring
+  uint32_t drainCycles;  // cycles() spent draining them into the pipeline
+  uint32_t dropped;      // Edges the ring overflowed
+};
+
+// cycles() reads a free-running cycle counter (return 0 to skip timing)
+template <typename Cfg, typename Ring, typename Cycles>
+SpeedTraceResult runSpeedTrace(float cps, Ring& ring, Cycles cycles) {
+  VelocityPipeline<Cfg> pipeline;
+  ring.clear();
+  const uint32_t startOverflows = ring.overflows();
+  uint32_t seenOverflows = startOverflows;
+  EncoderSnapshot snap = {};
+  snap.deltaSign = 1;
+  const double ticksPerUs = Cfg::edgeTickHz / 1e6;
+  uint32_t rng = 12345;
+  uint32_t prevTicks = 0;
+  double sqErr = 0.0;
+  int64_t edge = 1;
+  SpeedTraceResult result = {};
+
+  pipeline.update(snap, 0);
+  for (uint32_t w = 1; w <= SPEED_TRACE_WARMUP + SPEED_TRACE_WINDOWS; w++) {
+    uint32_t now = w * Cfg::sampleUs;
+    for (;;) {
+      double phase = (edge & 1) ? 0.05 : -0.05;
+      rng = rng * 1103515245u + 12345u;
+      double jitterUs = ((rng >> 16) & 0xFFFF) / 65536.0 - 0.5;
+      double tUs = (edge + phase) * 1e6 / cps + jitterUs;
+      if (tUs > now) break;
+
+      uint32_t ticks = (uint32_t)(tUs * ticksPerUs);
+      ring.push(ticks, 1, 0);
+      snap.position = edge;
+      snap.lastEdgeMicros = (uint32_t)tUs;
+      snap.lastEdgeTicks = ticks;
+      snap.edgeDeltaTicks = ticks - prevTicks;
+      prevTicks = ticks;
+      edge++;
+    }
+
+    EdgeEvent e;
+    uint32_t start = cycles();
+    while (ring.pop(e)) {
+      pipeline.addEdge(e);
+      result.drained++;
+    }
+    result.drainCycles += cycles() - start;
+    if (ring.overflows() != seenOverflows) {
+      seenOverflows = ring.overflows();
+      pipeline.edgesDropped();
+    }
+    pipeline.update(snap, now);
+
+    if (w > SPEED_TRACE_WARMUP) {
+      float err = (pipeline.countsPerSec() - cps) / cps;
+      sqErr += err * err;
+    }
+  }
+  result.dropped = ring.overflows() - startOverflows;
+  result.rmsPct = 100.0f * (float)sqrt(sqErr / SPEED_TRACE_WINDOWS);
+  return result;
+}
+
+// ====== ACCEL / CRUISE / DECEL PROFILE ======
+// Speed profile of python_client/serial_test_simulator.py (200 -> 1000 ->
+// 5000 -> 1000 -> 200 cps), with 0.2 s ramps between the cruise levels.
+// Edges are placed at the exact crossing times (+-0.5 us jitter). Lag is
+// the mean of (true - estimate) / accel over the second half of each ramp,
+// noise the RMS relative error over each cruise once 100 ms in.
+struct ProfileSegment {
+  float seconds;
+  float endCps;  // Speed ramps linearly to this over the segment
+};
+constexpr ProfileSegment PROFILE_TRACE_SEGMENTS[] = {
+    {0.5f, 200.0f},  {0.2f, 1000.0f}, {1.0f, 1000.0f}, {0.2f, 5000.0f}, {2.0f, 5000.0f},
+    {0.2f, 1000.0f}, {1.0f, 1000.0f}, {0.2f, 200.0f},  {0.5f, 200.0f},
+};
+constexpr float PROFILE_TRACE_SETTLE_SEC = 0.1f;
+
+struct ProfileFigures {
+  float lagMs;
+  float noisePct;
+};
+
+template <typename Cfg>
+ProfileFigures runProfileTrace() {
+  VelocityPipeline<Cfg> pipeline;
+  EncoderSnapshot snap = {};
+  snap.deltaSign = 1;
+  const double ticksPerUs = Cfg::edgeTickHz / 1e6;
+  const double dt = Cfg::sampleUs * 1e-6;
+  double pos = 0.0;
+  double v = PROFILE_TRACE_SEGMENTS[0].endCps;
+  uint32_t now = 0;
+  uint32_t prevTicks = 0;
+  uint32_t rng = 12345;
+  double lagSum = 0.0, sqNoise = 0.0;
+  uint32_t lagN = 0, noiseN = 0;
+
+  pipeline.update(snap, now);
+  for (const ProfileSegment& seg : PROFILE_TRACE_SEGMENTS) {
+    const double v0 = v;
+    const double a = (seg.endCps - v0) / seg.seconds;  // Exactly 0 when cruising
+    const uint32_t windows = (uint32_t)(seg.seconds / dt + 0.5);
+    for (uint32_t w = 1; w <= windows; w++) {
+      double next = pos + v * dt + 0.5 * a * dt * dt;
+      while ((double)(snap.position + 1) <= next) {
+        // Time into this window at which the shaft reaches the next count
+        double dx = (double)(snap.position + 1) - pos;
+        double tau = (a == 0.0) ? dx / v : (-v + sqrt(v * v + 2.0 * a * dx)) / a;
+        rng = rng * 1103515245u + 12345u;
+        double tUs = now + tau * 1e6 + ((rng >> 16) & 0xFFFF) / 65536.0 - 0.5;
+
+        EdgeEvent e = {(uint32_t)(tUs * ticksPerUs), 1, 0, false};
+        pipeline.addEdge(e);
+        snap.position++;
+        snap.lastEdgeMicros = (uint32_t)tUs;
+        snap.lastEdgeTicks = e.ticks;
+        snap.edgeDeltaTicks = e.ticks - prevTicks;
+        prevTicks = e.ticks;
+      }
+      pos = next;
+      v = v0 + a * w * dt;
+      now += Cfg::sampleUs;
+      pipeline.update(snap, now);
+
+      float err = pipeline.countsPerSec() - (float)v;
+      double into = w * dt;
+      if (a != 0.0 && into > 0.5 * seg.seconds) {
+        lagSum += -err / a;
+        lagN++;
+      } else if (a == 0.0 && into > PROFILE_TRACE_SETTLE_SEC) {
+        sqNoise += (err / v) * (err / v);
+        noiseN++;
+      }
+    }
+    v = seg.endCps;
+  }
+  ProfileFigures fig;
+  fig.lagMs = lagN ? 1000.0f * (float)(lagSum / lagN) : 0.0f;
+  fig.noisePct = noiseN ? 100.0f * (float)sqrt(sqNoise / noiseN) : 0.0f;
+  return fig;
+}
+
+// ====== FILTER BANK ======
+// Synthetic window counts straight into a VelocityFilter: 10-90% rise time
+// and overshoot of a 0 -> 10k cps step, steady lag behind a 100k cps/s
+// ramp, and output/input RMS of +-20 counts of noise per window
+constexpr uint32_t FILTER_TRACE_WINDOWS = 200;
+
+struct FilterFigures {
+  float riseMs;
+  float overshootPct;
+  float rampLagMs;
+  float noisePct;
+};
+
+inline float feedFilter(VelocityFilter& filter, int64_t& position, int32_t counts, float dtSec) {
+  position += counts;
+  return filter.update((float)counts / dtSec, position);
+}
+
+inline FilterFigures runFilterTrace(VelocityFilterType type, float param, uint32_t windowUs) {
+  const float dtSec = windowUs * 1e-6f;
+  VelocityFilter filter(param, windowUs);
+  FilterFigures fig;
+
+  // Step, after a full history at rest
+  const float stepCps = 10000.0f;
+  filter.configure(type, param, 0.0f);
+  int64_t position = 0;
+  for (uint32_t i = 0; i < VelocityFilter::MAX_TAPS; i++) {
+    feedFilter(filter, position, 0, dtSec);
+  }
+  int rise10 = -1, rise90 = -1;
+  float peak = 0.0f;
+  for (uint32_t i = 0; i < FILTER_TRACE_WINDOWS; i++) {
+    float v = feedFilter(filter, position, (int32_t)(stepCps * dtSec), dtSec);
+    if (rise10 < 0 && v >= 0.1f * stepCps) rise10 = i;
+    if (rise90 < 0 && v >= 0.9f * stepCps) rise90 = i;
+    if (v > peak) peak = v;
+  }
+  fig.riseMs = (rise90 - rise10) * dtSec * 1000.0f;
+  fig.overshootPct = 100.0f * (peak - stepCps) / stepCps;
+
+  // Ramp, from rest
+  const float accel = 100000.0f;
+  filter.configure(type, param, 0.0f);
+  position = 0;
+  double truePos = 0.0;
+  for (uint32_t i = 1; i <= FILTER_TRACE_WINDOWS; i++) {
+    double t = i * dtSec;
+    double next = 0.5 * accel * t * t;
+    int32_t counts = (int32_t)(floor(next) - floor(truePos));
+    truePos = next;
+    float v = feedFilter(filter, position, counts, dtSec);
+    fig.rampLagMs = (accel * (float)t - v) / accel * 1000.0f;
+  }
+
+  // Noise around a constant speed
+  filter.configure(type, param, stepCps);
+  position = 0;
+  uint32_t rng = 1;
+  double sqIn = 0.0, sqOut = 0.0;
+  for (uint32_t i = 0; i < FILTER_TRACE_WINDOWS; i++) {
+    rng = rng * 1103515245u + 12345u;
+    int32_t noise = (int32_t)((rng >> 16) % 41) - 20;
+    int32_t counts = (int32_t)(stepCps * dtSec) + noise;
+    float v = feedFilter(filter, position, counts, dtSec);
+    if (i >= VelocityFilter::MAX_TAPS) {
+      float inErr = (float)noise / dtSec;
+      sqIn += inErr * inErr;
+      sqOut += (v - stepCps) * (v - stepCps);
+    }
+  }
+  fig.noisePct = 100.0f * (float)sqrt(sqOut / sqIn);
+  return fig;
+}
+
+// ====== POSITION PREDICTION ======
+// Constant acceleration ramp (2000 cps + 20k cps/s) with quantized counts
+// and exact edge times. Per window: the held count and the extrapolated
+// position PREDICT_TRACE_AHEAD_US ahead, the bounded interpolation at the
+// window time, and a bounded query back to halfway through the count
+// before the last edge, each as RMS counts against the true position
+constexpr double PREDICT_TRACE_V0 = 2000.0;      // counts/s
+constexpr double PREDICT_TRACE_ACCEL = 20000.0;  // counts/s^2
+constexpr uint32_t PREDICT_TRACE_AHEAD_US = 2000;
+constexpr uint32_t PREDICT_TRACE_WARMUP = 50;
+constexpr uint32_t PREDICT_TRACE_WINDOWS = 1000;
+
+struct PredictionFigures {
+  float heldRms;       // Count as read, PREDICT_TRACE_AHEAD_US later
+  float predictedRms;  // Extrapolated PREDICT_TRACE_AHEAD_US ahead
+  float nowRms;        // Bounded, at the window time
+  float beforeRms;     // Bounded, before the last edge
+};
+
+// Time the ramp reaches position x
+inline double predictTraceTime(double x) {
+  const double v0 = PREDICT_TRACE_V0, a = PREDICT_TRACE_ACCEL;
+  return (-v0 + sqrt(v0 * v0 + 2.0 * a * x)) / a;
+}
+
+template <typename Cfg>
+PredictionFigures runPredictionTrace() {
+  VelocityPipeline<Cfg> pipeline;
+  EncoderSnapshot snap = {};
+  snap.deltaSign = 1;
+  const double v0 = PREDICT_TRACE_V0, a = PREDICT_TRACE_ACCEL;
+  const double dt = Cfg::sampleUs * 1e-6;
+  uint32_t now = 0;
+  double sqHeld = 0.0, sqPredicted = 0.0, sqNow = 0.0, sqBefore = 0.0;
+
+  pipeline.update(snap, now);
+  for (uint32_t i = 1; i <= PREDICT_TRACE_WARMUP + PREDICT_TRACE_WINDOWS; i++) {
+    now += Cfg::sampleUs;
+    double t = i * dt;
+    double truePos = v0 * t + 0.5 * a * t * t;
+    int64_t count = (int64_t)floor(truePos);
+    uint32_t edgeMicros = (uint32_t)(predictTraceTime((double)count) * 1e6);
+
+    snap.position = count;
+    snap.lastEdgeMicros = edgeMicros;
+    snap.edgeDeltaTicks = (uint32_t)(Cfg::edgeTickHz / (v0 + a * t));
+    pipeline.update(snap, now);
+
+    if (i > PREDICT_TRACE_WARMUP) {
+      double tAhead = t + PREDICT_TRACE_AHEAD_US * 1e-6;
+      double trueAhead = v0 * tAhead + 0.5 * a * tAhead * tAhead;
+      float cps = pipeline.predictionCountsPerSec();
+      float accel = pipeline.accelCountsPerSec2();
+      double predicted = extrapolatePosition(count, edgeMicros, 1, cps, accel,
+                                             now + PREDICT_TRACE_AHEAD_US, false);
+      double atNow = extrapolatePosition(count, edgeMicros, 1, cps, accel, now, true);
+      uint32_t beforeMicros = (uint32_t)(predictTraceTime(count - 0.5) * 1e6);
+      double before = extrapolatePosition(count, edgeMicros, 1, cps, accel, beforeMicros, true);
+      sqHeld += (count - trueAhead) * (count - trueAhead);
+      sqPredicted += (predicted - trueAhead) * (predicted - trueAhead);
+      sqNow += (atNow - truePos) * (atNow - truePos);
+      sqBefore += (before - (count - 0.5)) * (before - (count - 0.5));
+    }
+  }
+  PredictionFigures fig;
+  fig.heldRms = (float)sqrt(sqHeld / PREDICT_TRACE_WINDOWS);
+  fig.predictedRms = (float)sqrt(sqPredicted / PREDICT_TRACE_WINDOWS);
+  fig.nowRms = (float)sqrt(sqNow / PREDICT_TRACE_WINDOWS);
+  fig.beforeRms = (float)sqrt(sqBefore / PREDICT_TRACE_WINDOWS);
+  return fig;
+}
+
+#endif // TRACE_SIM_H
@@ -0,0 +1,35 @@
+#include "velocity.h"
+
+// ====== TRACKING OBSERVER ======
+
+// Fading-memory g-h-k gains for discount factor theta (Brookner)
+TrackingObserver::TrackingObserver(float theta)
+  : g(1.0f - theta * theta * theta),
+    h(1.5f * (1.0f - theta) * (1.0f - theta) * (1.0f + theta)),
+    k(0.5f * (1.0f - theta) * (1.0f - theta) * (1.0f - theta)) {}
+
+void TrackingObserver::reset(int64_t position) {
+  anchor = position;
+  x = 0.0f;
+  v = 0.0f;
+  a = 0.0f;
+}
+
+void TrackingObserver::update(int64_t position, float dtSec) {
+  if (dtSec <= 0.0f) return;
+
+  // Predict (x is relative to the previous measurement to keep float precision)
+  float xPred = x + v * dtSec + 0.5f * a * dtSec * dtSec;
+  float vPred = v + a * dtSec;
+
+  // Correct with the position residual
+  float measured = (float)(position - anchor);
+  float residual = measured - xPred;
+  x = xPred + g * residual;
+  v = vPred + (h / dtSec) * residual;
+  a = a + (2.0f * k / (dtSec * dtSec)) * residual;
+
+  // Re-anchor on the new measurement
+  x -= measured;
+  anchor = position;
+}
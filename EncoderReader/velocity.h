@@ -0,0 +1,503 @@
+#ifndef VELOCITY_H
+#define VELOCITY_H
+
+#include <stdint.h>
+#include <math.h>
+#include "edge_ring.h"
+#include "fixed_point.h"
+#include "regression.h"
+#include "velocity_filter.h"
+
+// ====== VELOCITY PIPELINE ======
+// Hardware independent (no Arduino includes) so it can be instantiated
+// with any compile-time config, on the target or on a host.
+
+// Consistent copy of the ISR-owned state, taken without masking interrupts
+struct EncoderSnapshot {
+  int64_t position;          // Continuous count; index zeroing is not applied here
+  int64_t indexOffset;       // Reported position = position - indexOffset
+  uint32_t lastEdgeMicros;   // esp_timer time of the last edge (for timeouts)
+  uint32_t edgeDeltaTicks;   // Last edge interval, in Cfg::edgeTickHz ticks
+  int8_t deltaSign;
+  uint32_t lastEdgeTicks;    // Time of the last edge, in Cfg::edgeTickHz ticks
+  // Bumped by every setPosition()/resetPosition() in the same seqlock write
+  // as the new position, with the sum of all such jumps (new - old)
+  uint32_t rebaseGeneration;
+  int64_t rebaseShift;
+};
+
+// Edges seen in the last completed window (from the edge ring), in edge ticks
+struct EdgeWindowStats {
+  uint32_t edges;
+  uint32_t firstTicks;
+  uint32_t lastTicks;
+  uint32_t minIntervalTicks;
+  uint32_t maxIntervalTicks;
+};
+
+enum class VelocityEstimator : uint8_t {
+  Window,         // counts per window only
+  FixedBlend,     // 50/50 window/edge blend
+  AdaptiveBlend,  // window at low speed, edge-weighted at high speed
+  Tracking,       // alpha-beta-gamma observer on position, no EMA
+  Regression,     // least-squares slope over the last edges, no EMA
+  MT,             // M/T: net counts over the exact time between edges, no EMA
+};
+
+// ====== POSITION EXTRAPOLATION ======
+// Sub-count position at time t from the last edge: edgePos was entered at
+// edgeMicros, moving in direction sign. Until the next edge the shaft is
+// within one count of that edge, so a bounded query (t not later than the
+// snapshot) clamps the advance to [0, 1) count in that direction. Before
+// the edge it was still in the previous count: a bounded query for an
+// earlier t interpolates back into it, down to its start (-1 count; older
+// edge times are not kept).
+inline double extrapolatePosition(int64_t edgePos, uint32_t edgeMicros, int8_t sign,
+                                  float cps, float accel, uint32_t t, bool bounded) {
+  float dt = (float)(int32_t)(t - edgeMicros) * 1e-6f;
+  float advance = cps * dt + 0.5f * accel * dt * dt;
+  if (bounded) {
+    float along = advance * sign;
+    float lo = (dt < 0.0f) ? -1.0f : 0.0f;
+    float hi = (dt < 0.0f) ? 0.0f : 0.999f;
+    if (along < lo) along = lo;
+    if (along > hi) along = hi;
+    advance = along * sign;
+  }
+  return (double)edgePos + advance;
+}
+
+// ====== TRACKING OBSERVER ======
+// Fading-memory alpha-beta-gamma filter: predicts position, velocity and
+// acceleration across each window and corrects all three with the position
+// residual. A single parameter theta in (0, 1) sets the gains; higher is
+// smoother but slower. Tracks constant acceleration without lag.
+class TrackingObserver {
+public:
+  explicit TrackingObserver(float theta);
+
+  void reset(int64_t position);
+  void update(int64_t position, float dtSec);
+  // Follow an external position jump without disturbing the state
+  void shift(int64_t counts) { anchor += counts; }
+
+  float velocity() const { return v; }      // counts/s
+  float acceleration() const { return a; }  // counts/s^2
+
+private:
+  float g, h, k;       // Position, velocity and acceleration gains
+  int64_t anchor = 0;  // Last measured position; x is kept relative to it
+  float x = 0.0f, v = 0.0f, a = 0.0f;
+};
+
+// Cfg must provide (all static constexpr):
+//   ppr, sampleUs, emaAlpha, timeoutUs, estimator, edgeTiming, edgeTickHz,
+//   observerTheta, fixedPoint, accelEstimate, regressionEdges, regressionSpanUs
+template <typename Cfg>
+class VelocityPipeline {
+public:
+  static_assert(Cfg::ppr > 0, "PPR must be positive");
+  static_assert(Cfg::sampleUs > 0, "Sample window must be positive");
+  static_assert(Cfg::emaAlpha > 0.0f && Cfg::emaAlpha <= 1.0f, "EMA alpha must be in (0, 1]");
+  static_assert(Cfg::observerTheta > 0.0f && Cfg::observerTheta < 1.0f, "Observer theta must be in (0, 1)");
+
+  static constexpr uint32_t COUNTS_PER_REV = 4 * Cfg::ppr;  // X4 decoding
+  static constexpr float REV_PER_COUNT = 1.0f / COUNTS_PER_REV;
+  static constexpr float RPM_PER_CPS = 60.0f / COUNTS_PER_REV;
+  static constexpr float EDGE_TICKS_PER_SEC = (float)Cfg::edgeTickHz;
+
+  // Fixed-point path: precomputed rates and gains (see fixed_point.h)
+  static_assert(Cfg::edgeTickHz < (1u << 28), "Edge tick rate too high for Q4 edge math");
+  static constexpr uint32_t WINDOW_RATE_NUM_Q12 = 1000000u << 12;  // 1e6 µs/s in Q12
+  static constexpr uint32_t NOMINAL_RATE_Q12 = WINDOW_RATE_NUM_Q12 / Cfg::sampleUs;
+  static constexpr uint32_t EDGE_RATE_NUM_Q4 = Cfg::edgeTickHz << 4;
+  static constexpr gain_t EMA_ALPHA_GAIN = toGain(Cfg::emaAlpha);
+
+  // Regression path: fit span and the hard limit (the timeout, capped to
+  // what the 64-bit sums hold), in edge ticks
+  static constexpr uint64_t EDGE_TICK_HZ_64 = Cfg::edgeTickHz;
+  static constexpr uint32_t REGRESSION_SPAN_TICKS =
+      (uint32_t)(Cfg::regressionSpanUs * EDGE_TICK_HZ_64 / 1000000u);
+  static constexpr uint64_t TIMEOUT_TICKS = Cfg::timeoutUs * EDGE_TICK_HZ_64 / 1000000u;
+  static constexpr uint32_t REGRESSION_LIMIT_TICKS =
+      TIMEOUT_TICKS < (1u << 26) ? (uint32_t)TIMEOUT_TICKS : (1u << 26) - 1;
+
+  // Returns true when a window completed and the estimate was updated.
+  // slackUs lets a timer-driven caller close a window slightly early.
+  bool update(const EncoderSnapshot& snap, uint32_t currentTime, uint32_t slackUs = 0);
+
+  // Feed one drained edge; call before update() for the same window
+  void addEdge(const EdgeEvent& e);
+  // The edge ring overflowed since the last drain: the edges fed so far end
+  // in a gap, so edge fits restart from the next edge
+  void edgesDropped();
+
+  // Runtime window length (the sampler's estimation period); Cfg::sampleUs
+  // is the default
+  void setWindowUs(uint32_t us) {
+    windowUs = us;
+    smoother.setWindowUs(us);
+  }
+
+  // Whether the estimate goes through the smoothing stage: the blend
+  // estimators do; Tracking, and Regression and M/T with edge timing, don't
+  static constexpr bool SMOOTHED =
+      !(Cfg::estimator == VelocityEstimator::Tracking ||
+        (Cfg::edgeTiming && (Cfg::estimator == VelocityEstimator::Regression ||
+                             Cfg::estimator == VelocityEstimator::MT)));
+
+  // Smoothing stage of the blend estimators (EMA with Cfg::emaAlpha by
+  // default); has no effect unless SMOOTHED
+  void setFilter(VelocityFilterType type, float param) {
+    smoother.configure(type, param, estCountsPerSec);
+    if (type == VelocityFilterType::EMA) emaAlphaGain = toGain(param);
+  }
+  const VelocityFilter& filter() const { return smoother; }
+
+
+  float countsPerSec() const { return estCountsPerSec; }
+  float revolutionsPerSec() const { return estCountsPerSec * REV_PER_COUNT; }
+  float rpm() const { return estCountsPerSec * RPM_PER_CPS; }
+  const EdgeWindowStats& edgeStats() const { return lastEdgeStats; }
+
+  // Observer acceleration, and its EMA-smoothed derivative (accelEstimate configs)
+  float accelCountsPerSec2() const { return estAccel; }
+  float jerkCountsPerSec3() const { return estJerk; }
+
+  // Velocity for extrapolation: the observer's (no EMA lag under constant
+  // acceleration) whenever it runs, the published estimate otherwise
+  float predictionCountsPerSec() const {
+    if constexpr (Cfg::estimator == VelocityEstimator::Tracking || Cfg::accelEstimate) {
+      return observer.velocity();
+    } else {
+      return estCountsPerSec;
+    }
+  }
+
+private:
+  float estCountsPerSec = 0.0f;  // EMA of the blend, or the observer velocity
+  int64_t lastSamplePos = 0;
+  uint32_t lastSample = 0;
+  uint32_t rebaseGeneration = 0;
+  int64_t rebaseShift = 0;
+  uint32_t windowUs = Cfg::sampleUs;
+  bool started = false;
+
+  TrackingObserver observer{Cfg::observerTheta};
+  float estAccel = 0.0f;
+  float estJerk = 0.0f;
+  q16_t estQ16 = 0;  // Fixed-point EMA state (fixedPoint configs only)
+  gain_t emaAlphaGain = EMA_ALPHA_GAIN;
+  VelocityFilter smoother{Cfg::emaAlpha, Cfg::sampleUs};
+
+  EdgeWindowStats windowEdges = {};
+  EdgeWindowStats lastEdgeStats = {};
+  uint32_t prevEdgeTicks = 0;
+  bool havePrevEdge = false;
+
+  EdgeRegression<Cfg::regressionEdges, REGRESSION_LIMIT_TICKS> regression;
+  int32_t regressionCount = 0;  // Cumulative edge deltas (only differences matter)
+
+  // M/T reference: position and time of the last edge of the previous measurement
+  int64_t mtRefPos = 0;
+  uint32_t mtRefTicks = 0;
+  bool mtRefValid = false;
+
+  float filterRegression(const EncoderSnapshot& snap, int64_t deltaCounts, uint32_t elapsed,
+                         bool timedOut, uint32_t currentTime);
+  float filterMT(const EncoderSnapshot& snap, int64_t deltaCounts, uint32_t elapsed,
+                 bool timedOut, uint32_t currentTime);
+  float capSinceLastEdge(float cps, const EncoderSnapshot& snap, uint32_t currentTime) const;
+  void rebase(const EncoderSnapshot& snap);
+  float filterBlend(const EncoderSnapshot& snap, int64_t deltaCounts, uint32_t elapsed, bool timedOut);
+  static float blend(float cpsWindow, float cpsEdge);
+  q16_t filterBlendQ16(const EncoderSnapshot& snap, int64_t deltaCounts, uint32_t elapsed, bool timedOut);
+  static q16_t blendQ16(q16_t cpsWindow, q16_t cpsEdge);
+};
+
+template <typename Cfg>
+void VelocityPipeline<Cfg>::addEdge(const EdgeEvent& e) {
+  if constexpr (Cfg::estimator == VelocityEstimator::Regression) {
+    regressionCount += e.delta;
+  }
+  // A rejected bounce only keeps the counts right; its time is no edge time
+  if (e.glitch) return;
+
+  if (windowEdges.edges == 0) {
+    windowEdges.firstTicks = e.ticks;
+    windowEdges.minIntervalTicks = UINT32_MAX;
+  }
+  if (havePrevEdge) {
+    uint32_t interval = e.ticks - prevEdgeTicks;
+    if (interval < windowEdges.minIntervalTicks) windowEdges.minIntervalTicks = interval;
+    if (interval > windowEdges.maxIntervalTicks) windowEdges.maxIntervalTicks = interval;
+  }
+  windowEdges.lastTicks = e.ticks;
+  windowEdges.edges++;
+  prevEdgeTicks = e.ticks;
+  havePrevEdge = true;
+
+  if constexpr (Cfg::estimator == VelocityEstimator::Regression) {
+    regression.add(e.ticks, regressionCount);
+  }
+}
+
+template <typename Cfg>
+void VelocityPipeline<Cfg>::edgesDropped() {
+  if constexpr (Cfg::estimator == VelocityEstimator::Regression) {
+    regression.clear();
+  }
+}
+
+template <typename Cfg>
+bool VelocityPipeline<Cfg>::update(const EncoderSnapshot& snap, uint32_t currentTime, uint32_t slackUs) {
+  if (!started) {
+    lastSample = currentTime;
+    lastSamplePos = snap.position;
+    observer.reset(snap.position);
+    rebaseGeneration = snap.rebaseGeneration;
+    rebaseShift = snap.rebaseShift;
+    started = true;
+  }
+  if (snap.rebaseGeneration != rebaseGeneration) {
+    rebase(snap);
+  }
+
+  uint32_t elapsed = currentTime - lastSample;
+  if (elapsed + slackUs < windowUs) return false;
+
+  int64_t deltaCounts = snap.position - lastSamplePos;
+  lastSamplePos = snap.position;
+
+  bool timedOut = (currentTime - snap.lastEdgeMicros) > Cfg::timeoutUs;
+
+  // The observer tracks position, velocity and acceleration from the raw
+  // window counts. It is the estimator in Tracking mode and the
+  // acceleration source for every estimator.
+  constexpr bool runObserver =
+      Cfg::estimator == VelocityEstimator::Tracking || Cfg::accelEstimate;
+  if constexpr (runObserver) {
+    float dtSec = (float)elapsed * 1e-6f;
+    observer.update(snap.position, dtSec);
+    if (Cfg::edgeTiming && timedOut) {
+      observer.reset(snap.position);  // Stopped: drop residual velocity/accel
+    }
+    if constexpr (Cfg::accelEstimate) {
+      float accel = observer.acceleration();
+      estJerk += Cfg::emaAlpha * ((accel - estAccel) / dtSec - estJerk);
+      estAccel = accel;
+    }
+  }
+
+  if constexpr (Cfg::estimator == VelocityEstimator::Tracking) {
+    estCountsPerSec = observer.velocity();
+  } else if constexpr (Cfg::estimator == VelocityEstimator::Regression && Cfg::edgeTiming) {
+    estCountsPerSec = filterRegression(snap, deltaCounts, elapsed, timedOut, currentTime);
+  } else if constexpr (Cfg::estimator == VelocityEstimator::MT && Cfg::edgeTiming) {
+    estCountsPerSec = filterMT(snap, deltaCounts, elapsed, timedOut, currentTime);
+  } else if constexpr (Cfg::fixedPoint) {
+    estQ16 = filterBlendQ16(snap, deltaCounts, elapsed, timedOut);
+    estCountsPerSec = q16ToFloat(estQ16);
+  } else {
+    estCountsPerSec = filterBlend(snap, deltaCounts, elapsed, timedOut);
+  }
+
+  // Publish this window's edge statistics and start a new window
+  lastEdgeStats = windowEdges;
+  if (lastEdgeStats.edges == 0) lastEdgeStats.minIntervalTicks = 0;
+  windowEdges = {};
+
+  lastSample = currentTime;
+  return true;
+}
+
+// The position was set externally. This is the first snapshot showing the
+// new value, so move the window anchors by the jump: the window counts
+// stay the real motion and the estimate carries on
+template <typename Cfg>
+void VelocityPipeline<Cfg>::rebase(const EncoderSnapshot& snap) {
+  int64_t shift = snap.rebaseShift - rebaseShift;
+  rebaseGeneration = snap.rebaseGeneration;
+  rebaseShift = snap.rebaseShift;
+  lastSamplePos += shift;
+  mtRefPos += shift;
+  observer.shift(shift);
+  smoother.reset();  // Savitzky-Golay holds positions
+}
+
+// ====== EDGE REGRESSION ======
+// Slope of the edge fit, unfiltered: averaging over up to regressionEdges
+// edges already removes the per-edge timing noise, and the fit only looks
+// back regressionSpanUs, so lag stays bounded at low speed
+
+template <typename Cfg>
+float VelocityPipeline<Cfg>::filterRegression(const EncoderSnapshot& snap, int64_t deltaCounts,
+                                              uint32_t elapsed, bool timedOut,
+                                              uint32_t currentTime) {
+  if (timedOut) {
+    regression.clear();
+    return 0.0f;
+  }
+
+  float cps;
+  float countsPerTick;
+  regression.trim(REGRESSION_SPAN_TICKS);
+  if (regression.slope(countsPerTick)) {
+    cps = countsPerTick * EDGE_TICKS_PER_SEC;
+  } else {
+    cps = (float)deltaCounts * 1e6f / (float)elapsed;
+  }
+  return capSinceLastEdge(cps, snap, currentTime);
+}
+
+// ====== M/T METHOD ======
+// Net counts between the last edge of the previous measurement and the
+// last edge of this window, over the exact edge-to-edge time. Both ends
+// sit on edges, so the count is exact and the only error is one edge tick
+// over the span: constant relative accuracy at any speed. A window without
+// edges extends the measurement into the next one and holds the estimate.
+//
+// Count and time both come from the snapshot (position and the time of the
+// edge that produced it), not from the edge ring, so M/T has no edge rate
+// limit. In ISR mode they are written together; in PCNT mode the counter
+// can be one or two edges ahead of the capture ISR, which only matters
+// over a span of few counts.
+
+template <typename Cfg>
+float VelocityPipeline<Cfg>::filterMT(const EncoderSnapshot& snap, int64_t deltaCounts,
+                                      uint32_t elapsed, bool timedOut, uint32_t currentTime) {
+  if (timedOut) {
+    mtRefValid = false;
+    return 0.0f;
+  }
+
+  float cps = estCountsPerSec;
+  if (!mtRefValid) {
+    // First window after a stop: the span starts at its last edge
+    cps = (float)deltaCounts * 1e6f / (float)elapsed;
+    mtRefValid = true;
+  } else if (snap.lastEdgeTicks != mtRefTicks) {
+    uint32_t spanTicks = snap.lastEdgeTicks - mtRefTicks;
+    cps = (float)(snap.position - mtRefPos) * EDGE_TICKS_PER_SEC / (float)spanTicks;
+  }
+  mtRefPos = snap.position;
+  mtRefTicks = snap.lastEdgeTicks;
+  return capSinceLastEdge(cps, snap, currentTime);
+}
+
+// A whole window without an edge means less than one count moved since
+// lastEdgeMicros, which caps the speed while the shaft slows to a stop
+template <typename Cfg>
+float VelocityPipeline<Cfg>::capSinceLastEdge(float cps, const EncoderSnapshot& snap,
+                                              uint32_t currentTime) const {
+  uint32_t sinceEdge = currentTime - snap.lastEdgeMicros;
+  if (sinceEdge > windowUs) {
+    float bound = 1e6f / (float)sinceEdge;
+    if (fabsf(cps) > bound) cps = cps < 0.0f ? -bound : bound;
+  }
+  return cps;
+}
+
+template <typename Cfg>
+float VelocityPipeline<Cfg>::filterBlend(const EncoderSnapshot& snap, int64_t deltaCounts,
+                                         uint32_t elapsed, bool timedOut) {
+  // Calculate window-based speed
+  float cpsWindow = (float)deltaCounts * 1e6f / (float)elapsed;
+
+  float blended = cpsWindow;
+  if constexpr (Cfg::edgeTiming && Cfg::estimator != VelocityEstimator::Window) {
+    // Calculate signed edge-based speed
+    float cpsEdge = 0.0f;
+    if (snap.edgeDeltaTicks > 0 && !timedOut) {
+      cpsEdge = (EDGE_TICKS_PER_SEC / (float)snap.edgeDeltaTicks) * snap.deltaSign;
+    }
+    blended = blend(cpsWindow, cpsEdge);
+  }
+
+  if constexpr (Cfg::edgeTiming) {
+    // Velocity timeout - force to zero if no recent edges
+    if (timedOut) {
+      blended = 0.0f;
+    }
+  }
+
+  // Apply the smoothing filter (EMA unless changed at runtime)
+  return smoother.update(blended, snap.position);
+}
+
+template <typename Cfg>
+float VelocityPipeline<Cfg>::blend(float cpsWindow, float cpsEdge) {
+  if constexpr (Cfg::estimator == VelocityEstimator::AdaptiveBlend) {
+    // Adaptive blending based on velocity magnitude
+    float absWindow = fabsf(cpsWindow);
+    float absEdge = fabsf(cpsEdge);
+
+    if (absWindow < 10.0f) {
+      // Low speed: prefer window-based
+      return cpsWindow;
+    } else if (absWindow > 1000.0f && absEdge > 0) {
+      // High speed: prefer edge-based
+      return 0.7f * cpsEdge + 0.3f * cpsWindow;
+    }
+  }
+  // Medium speed (or fixed blend): balanced blend
+  return (cpsWindow != 0 && cpsEdge != 0) ? (0.5f * cpsWindow + 0.5f * cpsEdge)
+                                          : (cpsWindow != 0 ? cpsWindow : cpsEdge);
+}
+
+// ====== FIXED-POINT BLEND ======
+// Same window/edge/blend/EMA math as above in Q16, without float divisions
+
+template <typename Cfg>
+q16_t VelocityPipeline<Cfg>::filterBlendQ16(const EncoderSnapshot& snap, int64_t deltaCounts,
+                                            uint32_t elapsed, bool timedOut) {
+  // Windows per second in Q12: a constant for the nominal window, otherwise
+  // one 32-bit division
+  uint32_t rateQ12 = (elapsed == Cfg::sampleUs) ? NOMINAL_RATE_Q12 : (WINDOW_RATE_NUM_Q12 / elapsed);
+  q16_t cpsWindow = deltaCounts * (q16_t)rateQ12 * (1 << (Q16_SHIFT - 12));
+
+  q16_t blended = cpsWindow;
+  if constexpr (Cfg::edgeTiming && Cfg::estimator != VelocityEstimator::Window) {
+    // Signed edge-based speed: ticks/s over the edge interval, in Q4
+    q16_t cpsEdge = 0;
+    if (snap.edgeDeltaTicks > 0 && !timedOut) {
+      cpsEdge = (q16_t)(EDGE_RATE_NUM_Q4 / snap.edgeDeltaTicks) << (Q16_SHIFT - 4);
+      if (snap.deltaSign < 0) cpsEdge = -cpsEdge;
+    }
+    blended = blendQ16(cpsWindow, cpsEdge);
+  }
+
+  if constexpr (Cfg::edgeTiming) {
+    // Velocity timeout - force to zero if no recent edges
+    if (timedOut) {
+      blended = 0;
+    }
+  }
+
+  // Apply EMA filter: est += alpha * (x - est). The rest of the filter bank
+  // runs in float on the converted value.
+  if (smoother.type() != VelocityFilterType::EMA) {
+    return toQ16(smoother.update(q16ToFloat(blended), snap.position));
+  }
+  return estQ16 + mulQ16(blended - estQ16, emaAlphaGain);
+}
+
+template <typename Cfg>
+q16_t VelocityPipeline<Cfg>::blendQ16(q16_t cpsWindow, q16_t cpsEdge) {
+  if constexpr (Cfg::estimator == VelocityEstimator::AdaptiveBlend) {
+    q16_t absWindow = absQ16(cpsWindow);
+
+    if (absWindow < toQ16(10.0f)) {
+      // Low speed: prefer window-based
+      return cpsWindow;
+    } else if (absWindow > toQ16(1000.0f) && cpsEdge != 0) {
+      // High speed: prefer edge-based
+      return mulQ16(cpsEdge, toGain(0.7f)) + mulQ16(cpsWindow, toGain(0.3f));
+    }
+  }
+  // Medium speed (or fixed blend): balanced blend
+  return (cpsWindow != 0 && cpsEdge != 0) ? ((cpsWindow + cpsEdge) >> 1)
+                                          : (cpsWindow != 0 ? cpsWindow : cpsEdge);
+}
+
+#endif // VELOCITY_H
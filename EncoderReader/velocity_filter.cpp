@@ -0,0 +1,136 @@
+#include "velocity_filter.h"
+#include <math.h>
+
+// ====== VELOCITY FILTER BANK ======
+
+VelocityFilter::VelocityFilter(float emaAlpha, uint32_t windowUs)
+  : filterParam(emaAlpha), windowUs(windowUs) {}
+
+bool VelocityFilter::valid(VelocityFilterType type, float param) {
+  switch (type) {
+    case VelocityFilterType::EMA:
+      return param > 0.0f && param <= 1.0f;
+    case VelocityFilterType::MovingAverage:
+      return param >= 2.0f && param <= (float)MAX_TAPS;
+    case VelocityFilterType::SavitzkyGolay:
+      return param >= 3.0f && param <= (float)MAX_TAPS;
+    case VelocityFilterType::Butterworth:
+      return param > 0.0f;
+  }
+  return false;
+}
+
+const char* VelocityFilter::name(VelocityFilterType type) {
+  switch (type) {
+    case VelocityFilterType::EMA: return "EMA";
+    case VelocityFilterType::MovingAverage: return "MA";
+    case VelocityFilterType::SavitzkyGolay: return "SG";
+    case VelocityFilterType::Butterworth: return "BW";
+  }
+  return "?";
+}
+
+void VelocityFilter::configure(VelocityFilterType type, float param, float current) {
+  filterType = type;
+  filterParam = param;
+  output = current;
+  bool windowed = type == VelocityFilterType::MovingAverage ||
+                  type == VelocityFilterType::SavitzkyGolay;
+  length = windowed ? (uint32_t)param : 1;
+  reset();
+  design();
+  // Start the biquad at steady state on the current output, so switching
+  // filters does not kick the estimate
+  z1 = (1.0f - b0) * output;
+  z2 = (b2 - a2) * output;
+}
+
+void VelocityFilter::setWindowUs(uint32_t us) {
+  windowUs = us;
+  design();
+}
+
+// Drops the tap history, e.g. after the position was set externally;
+// the output and the Butterworth state carry on
+void VelocityFilter::reset() {
+  used = 0;
+  oldest = 0;
+  sum = 0;
+  weightedSum = 0;
+}
+
+// Second-order Butterworth low-pass by bilinear transform; the cutoff is
+// kept below Nyquist of the window rate
+void VelocityFilter::design() {
+  if (filterType != VelocityFilterType::Butterworth) return;
+  float fs = 1e6f / (float)windowUs;
+  float fc = filterParam < 0.45f * fs ? filterParam : 0.45f * fs;
+  float k = tanf((float)M_PI * fc / fs);
+  float norm = 1.0f / (1.0f + (float)M_SQRT2 * k + k * k);
+  b0 = k * k * norm;
+  b1 = 2.0f * b0;
+  b2 = b0;
+  a1 = 2.0f * (k * k - 1.0f) * norm;
+  a2 = (1.0f - (float)M_SQRT2 * k + k * k) * norm;
+}
+
+float VelocityFilter::update(float cps, int64_t position) {
+  switch (filterType) {
+    case VelocityFilterType::EMA:
+      output = filterParam * cps + (1.0f - filterParam) * output;
+      break;
+
+    case VelocityFilterType::MovingAverage: {
+      int64_t q8 = (int64_t)(cps * 256.0f);
+      if (used < length) {
+        taps[used++] = q8;
+      } else {
+        sum -= taps[oldest];
+        taps[oldest] = q8;
+        oldest = (oldest + 1) % length;
+      }
+      sum += q8;
+      output = (float)sum / (256.0f * (float)used);
+      break;
+    }
+
+    case VelocityFilterType::SavitzkyGolay:
+      output = updateSavitzkyGolay(position);
+      if (used < 2) output = cps;
+      break;
+
+    case VelocityFilterType::Butterworth: {
+      float y = b0 * cps + z1;
+      z1 = b1 * cps - a1 * y + z2;
+      z2 = b2 * cps - a2 * y;
+      output = y;
+      break;
+    }
+  }
+  return output;
+}
+
+// Slope of the least-squares line through the held positions (k = 0 is the
+// oldest, centre c = (n-1)/2):
+//   sum (k-c) p_k = (2 * weightedSum - (n-1) * sum) / 2,  sum (k-c)^2 = n(n^2-1)/12
+// When the window slides every index drops by one, so weightedSum loses
+// the remaining taps once and the new tap enters at k = n-1.
+float VelocityFilter::updateSavitzkyGolay(int64_t position) {
+  if (used < length) {
+    weightedSum += (int64_t)used * position;
+    sum += position;
+    taps[used++] = position;
+  } else {
+    int64_t dropped = taps[oldest];
+    weightedSum += (int64_t)(length - 1) * position - (sum - dropped);
+    sum += position - dropped;
+    taps[oldest] = position;
+    oldest = (oldest + 1) % length;
+  }
+  if (used < 2) return output;
+
+  int64_t n = used;
+  int64_t numerator = 2 * weightedSum - (n - 1) * sum;
+  float countsPerWindow = 6.0f * (float)numerator / (float)(n * (n * n - 1));
+  return countsPerWindow * 1e6f / (float)windowUs;
+}
@@ -0,0 +1,69 @@
+#ifndef VELOCITY_FILTER_H
+#define VELOCITY_FILTER_H
+
+#include <stdint.h>
+
+enum class VelocityFilterType : uint8_t {
+  EMA,            // param = alpha in (0, 1]; single pole, long tail
+  MovingAverage,  // param = N windows; lag (N-1)/2 windows, nothing after that
+  SavitzkyGolay,  // param = N windows; centre derivative of the window positions
+  Butterworth,    // param = cutoff Hz; second order, no overshoot on a ramp
+};
+
+// ====== VELOCITY FILTER BANK ======
+// Hardware independent smoothing stage of the blend estimators, selectable
+// at runtime. Fixed memory (MAX_TAPS) and O(1) work per window for every
+// type: the moving average keeps an exact integer running sum of Q8
+// velocities, and Savitzky-Golay keeps the two integer sums its derivative
+// weights need, updated as the window slides, so neither ever drifts.
+//
+// Savitzky-Golay fits a quadratic to the last N window positions; its
+// derivative at the centre point equals the least-squares slope, so it
+// reads position and ignores the blended velocity. Butterworth is designed
+// by bilinear transform for the current window rate.
+class VelocityFilter {
+public:
+  static constexpr uint32_t MAX_TAPS = 32;
+
+  VelocityFilter(float emaAlpha, uint32_t windowUs);
+
+  // Range check before configure(): alpha (0, 1], 2..MAX_TAPS (3.. for
+  // Savitzky-Golay), cutoff > 0 Hz
+  static bool valid(VelocityFilterType type, float param);
+  static const char* name(VelocityFilterType type);
+
+  // Select a filter, continuing from the current estimate; clears the history
+  void configure(VelocityFilterType type, float param, float current);
+  // New window rate (sampler RATE): redesigns rate-dependent coefficients
+  void setWindowUs(uint32_t us);
+  void reset();
+
+  // One window: the raw (unsmoothed) velocity and the position at its end
+  float update(float cps, int64_t position);
+
+  VelocityFilterType type() const { return filterType; }
+  float param() const { return filterParam; }
+
+private:
+  VelocityFilterType filterType = VelocityFilterType::EMA;
+  float filterParam;
+  uint32_t windowUs;
+  float output = 0.0f;
+
+  // Moving average (Q8 velocities) / Savitzky-Golay (positions) history
+  int64_t taps[MAX_TAPS];
+  uint32_t length = 1;  // N
+  uint32_t used = 0;
+  uint32_t oldest = 0;
+  int64_t sum = 0;         // Sum of the held taps
+  int64_t weightedSum = 0; // Sum of k * tap[k], k = 0 for the oldest (Savitzky-Golay)
+
+  // Butterworth biquad (transposed direct form II)
+  float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+  float z1 = 0.0f, z2 = 0.0f;
+
+  void design();
+  float updateSavitzkyGolay(int64_t position);
+};
+
+#endif // VELOCITY_FILTER_H
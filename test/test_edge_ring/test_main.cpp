@@ -0,0 +1,202 @@
+// Host test of the ISR-mode edge path: quadrature table, glitch filter and
+// edge ring as decodeAB() drives them, on a bouncing encoder, then the
+// drained ring through the edge estimators. The ring deltas must sum to
+// the position, or M/T and the regression count bounces twice. Fast
+// same-direction edges and slow reversals must never be rejected.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdint.h>
+#include "quadrature.h"
+#include "glitch_filter.h"
+#include "edge_ring.h"
+#include "velocity.h"
+// Out-of-line parts of the pipeline (the sketch sources are not built here)
+#include "velocity.cpp"
+#include "velocity_filter.cpp"
+
+constexpr uint32_t RING_SIZE = 256;    // EDGE_RING_SIZE
+constexpr uint32_t EDGE_US = 200;      // 5000 cps
+constexpr uint32_t BOUNCE_US = 2;      // Bounce back, then the same edge again
+constexpr uint32_t EDGES = 1000;
+constexpr uint32_t WINDOW_US = 10000;
+
+// The count, timing and ring updates of EncoderBase::decodeAB() (ISR mode,
+// no double-step inference), without the seqlock
+struct EdgeReplay {
+  int64_t position = 0;
+  uint8_t lastStateAB = 0;
+  uint32_t lastEdgeMicros = 0;
+  uint32_t edgeDeltaTicks = 0;
+  int8_t lastDeltaSign = 1;
+  uint32_t prevEdgeMicros = 0;
+  uint32_t prevEdgeDeltaTicks = 0;
+  GlitchFilter<1, 20, 2> glitchFilter;  // Config defaults
+  EdgeRing<RING_SIZE> ring;
+
+  void decode(uint8_t newState, uint32_t now) {
+    int8_t delta = quadDelta(lastStateAB, newState);
+    if (delta) {
+      int8_t dir = (delta > 0) ? 1 : -1;
+      uint32_t interval = now - lastEdgeMicros;
+      bool real = glitchFilter.accept(interval, dir, lastDeltaSign);
+      position += delta;
+      if (real) {
+        prevEdgeMicros = lastEdgeMicros;
+        prevEdgeDeltaTicks = edgeDeltaTicks;
+        edgeDeltaTicks = interval;
+        lastEdgeMicros = now;
+        lastDeltaSign = dir;
+      } else {
+        lastEdgeMicros = prevEdgeMicros;
+        edgeDeltaTicks = prevEdgeDeltaTicks;
+      }
+      ring.push(now, delta, newState, !real);
+    }
+    lastStateAB = newState;
+  }
+
+  EncoderSnapshot snapshot() const {
+    EncoderSnapshot snap = {};
+    snap.position = position;
+    snap.lastEdgeMicros = lastEdgeMicros;
+    snap.edgeDeltaTicks = edgeDeltaTicks;
+    snap.deltaSign = lastDeltaSign;
+    snap.lastEdgeTicks = lastEdgeMicros;
+    return snap;
+  }
+};
+
+// Forward Gray sequence, +1 per step
+static const uint8_t FORWARD[4] = {0b01, 0b11, 0b10, 0b00};
+
+// One clean step in direction dir at time t, draining the ring into ringSum
+// so it never overflows
+static void step(EdgeReplay& replay, int8_t dir, uint32_t t, int64_t& ringSum) {
+  uint8_t i = 0;
+  while (FORWARD[i] != replay.lastStateAB) i++;
+  replay.decode(FORWARD[(i + (dir > 0 ? 1 : 3)) & 3], t);
+  EdgeEvent e;
+  while (replay.ring.pop(e)) ringSum += e.delta;
+}
+
+struct ReplayConfig {
+  static constexpr uint32_t ppr = 1000;
+  static constexpr uint32_t sampleUs = WINDOW_US;
+  static constexpr float emaAlpha = 0.4f;
+  static constexpr uint32_t timeoutUs = 500000;
+  static constexpr VelocityEstimator estimator = VelocityEstimator::MT;
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 1000000;  // esp_timer µs
+  static constexpr float observerTheta = 0.8f;
+  static constexpr bool fixedPoint = false;
+  static constexpr bool accelEstimate = false;
+  static constexpr uint32_t regressionEdges = 16;
+  static constexpr uint32_t regressionSpanUs = 5000;
+};
+
+struct ReplayRegressionConfig : ReplayConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::Regression;
+};
+
+// Every edge bounces once; the ring is drained into the pipeline once per
+// window, as updateSpeed() does. Returns the last estimate.
+template <typename Cfg>
+static float replayBouncingEdges(EdgeReplay& replay, int64_t& ringSum) {
+  VelocityPipeline<Cfg> pipeline;
+  uint32_t windowEnd = WINDOW_US;
+  ringSum = 0;
+  pipeline.update(replay.snapshot(), 0);
+
+  for (uint32_t i = 0; i < EDGES; i++) {
+    uint32_t t = (i + 1) * EDGE_US;
+    if (t + 2 * BOUNCE_US > windowEnd) {
+      EdgeEvent e;
+      while (replay.ring.pop(e)) {
+        ringSum += e.delta;
+        pipeline.addEdge(e);
+      }
+      pipeline.update(replay.snapshot(), windowEnd);
+      windowEnd += WINDOW_US;
+    }
+
+    uint8_t state = FORWARD[i & 3];
+    uint8_t previous = replay.lastStateAB;
+    replay.decode(state, t);
+    replay.decode(previous, t + BOUNCE_US);
+    replay.decode(state, t + 2 * BOUNCE_US);
+  }
+  EdgeEvent e;
+  while (replay.ring.pop(e)) ringSum += e.delta;
+  return pipeline.countsPerSec();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_ring_sum_equals_position() {
+  EdgeReplay replay;
+  int64_t ringSum;
+  replayBouncingEdges<ReplayConfig>(replay, ringSum);
+  TEST_ASSERT_EQUAL_UINT32(0, replay.ring.overflows());
+  TEST_ASSERT_EQUAL_UINT32(EDGES, replay.glitchFilter.rejects());
+  TEST_ASSERT_EQUAL_INT64(EDGES, replay.position);
+  TEST_ASSERT_EQUAL_INT64(replay.position, ringSum);
+}
+
+void test_mt_counts_a_bounce_once() {
+  EdgeReplay replay;
+  int64_t ringSum;
+  float cps = replayBouncingEdges<ReplayConfig>(replay, ringSum);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f * 5000.0f, 5000.0f, cps);
+}
+
+void test_regression_counts_a_bounce_once() {
+  EdgeReplay replay;
+  int64_t ringSum;
+  float cps = replayBouncingEdges<ReplayRegressionConfig>(replay, ringSum);
+  TEST_ASSERT_FLOAT_WITHIN(0.02f * 5000.0f, 5000.0f, cps);
+}
+
+// Same-direction edges far closer than the glitch threshold (3 us, after
+// slow edges left it at its 20 us ceiling) are never glitches: no speed cap
+void test_fast_edges_not_rejected() {
+  EdgeReplay replay;
+  int64_t ringSum = 0;
+  uint32_t t = 0;
+  for (uint32_t i = 0; i < 100; i++) step(replay, 1, t += EDGE_US, ringSum);
+  for (uint32_t i = 0; i < EDGES; i++) step(replay, 1, t += 3, ringSum);
+  TEST_ASSERT_EQUAL_UINT32(0, replay.glitchFilter.rejects());
+  TEST_ASSERT_EQUAL_INT64(100 + EDGES, replay.position);
+  TEST_ASSERT_EQUAL_INT64(replay.position, ringSum);
+  TEST_ASSERT_EQUAL_UINT32(3, replay.edgeDeltaTicks);
+}
+
+// A genuine turnaround at the edge rate is well past the threshold: the
+// reversing edge is timed and sets the direction
+void test_slow_reversal_accepted() {
+  EdgeReplay replay;
+  int64_t ringSum = 0;
+  uint32_t t = 0;
+  for (uint32_t i = 0; i < 100; i++) step(replay, 1, t += EDGE_US, ringSum);
+  step(replay, -1, t += EDGE_US, ringSum);
+  TEST_ASSERT_EQUAL_UINT32(0, replay.glitchFilter.rejects());
+  TEST_ASSERT_EQUAL_INT8(-1, replay.lastDeltaSign);
+  TEST_ASSERT_EQUAL_UINT32(t, replay.lastEdgeMicros);
+  TEST_ASSERT_EQUAL_UINT32(EDGE_US, replay.edgeDeltaTicks);
+  for (uint32_t i = 0; i < 50; i++) step(replay, -1, t += EDGE_US, ringSum);
+  TEST_ASSERT_EQUAL_UINT32(0, replay.glitchFilter.rejects());
+  TEST_ASSERT_EQUAL_INT64(100 - 51, replay.position);
+  TEST_ASSERT_EQUAL_INT64(replay.position, ringSum);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_sum_equals_position);
+  RUN_TEST(test_mt_counts_a_bounce_once);
+  RUN_TEST(test_regression_counts_a_bounce_once);
+  RUN_TEST(test_fast_edges_not_rejected);
+  RUN_TEST(test_slow_reversal_accepted);
+  return UNITY_END();
+}
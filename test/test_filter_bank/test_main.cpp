@@ -0,0 +1,90 @@
+// Host test of the velocity filter bank on the synthetic window counts of
+// trace_sim.h at 10 ms windows (the figures BENCH prints): 10-90% step
+// rise, overshoot, lag behind a ramp and output/input noise of each type.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "trace_sim.h"
+// Out-of-line parts of the pipeline (the sketch sources are not built here)
+#include "velocity.cpp"
+#include "velocity_filter.cpp"
+
+constexpr uint32_t WINDOW_US = 10000;  // SPEED_SAMPLE_US
+
+struct FilterExpectation {
+  VelocityFilterType type;
+  float param;
+  FilterFigures expected;
+};
+
+// Window counts lag the speed by half a window (5 ms) before any filter.
+// EMA 0.4: rise ln 9 / ln(1/0.6) = 4.3 windows, lag (1-a)/a windows,
+//   noise sqrt(a/(2-a)) = 50%
+// MA 8: rise 7 windows, lag (N-1)/2 windows, noise 1/sqrt(N) = 35%
+// SG 9: slope of the centred fit, lag (N-1)/2 windows
+// BW 10 Hz: second order, 4.3% overshoot, lag sqrt(2)/(2 pi fc) = 22.5 ms
+// The noise figures are for this 168-window sample of the trace.
+static const FilterExpectation CASES[] = {
+    {VelocityFilterType::EMA, 0.4f, {40.0f, 0.0f, 19.8f, 48.3f}},
+    {VelocityFilterType::MovingAverage, 8.0f, {70.0f, 0.0f, 39.9f, 33.5f}},
+    {VelocityFilterType::SavitzkyGolay, 9.0f, {50.0f, 0.0f, 39.9f, 36.3f}},
+    {VelocityFilterType::Butterworth, 10.0f, {30.0f, 5.0f, 26.5f, 46.5f}},
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void checkFigure(const char* what, const FilterExpectation& c, float tolerance,
+                        float expected, float actual) {
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%s %.1f: %s", VelocityFilter::name(c.type), c.param, what);
+  TEST_ASSERT_FLOAT_WITHIN_MESSAGE(tolerance, expected, actual, msg);
+}
+
+void test_step_response() {
+  for (const FilterExpectation& c : CASES) {
+    FilterFigures fig = runFilterTrace(c.type, c.param, WINDOW_US);
+    checkFigure("10-90% rise ms", c, 0.5f, c.expected.riseMs, fig.riseMs);
+    checkFigure("overshoot %", c, 0.2f, c.expected.overshootPct, fig.overshootPct);
+  }
+}
+
+void test_ramp_lag() {
+  for (const FilterExpectation& c : CASES) {
+    FilterFigures fig = runFilterTrace(c.type, c.param, WINDOW_US);
+    checkFigure("ramp lag ms", c, 0.5f, c.expected.rampLagMs, fig.rampLagMs);
+  }
+}
+
+void test_noise() {
+  for (const FilterExpectation& c : CASES) {
+    FilterFigures fig = runFilterTrace(c.type, c.param, WINDOW_US);
+    checkFigure("noise out/in %", c, 0.5f, c.expected.noisePct, fig.noisePct);
+  }
+}
+
+// Every filter must settle on a constant input without a steady error
+void test_step_settles() {
+  for (const FilterExpectation& c : CASES) {
+    VelocityFilter filter(c.param, WINDOW_US);
+    filter.configure(c.type, c.param, 0.0f);
+    int64_t position = 0;
+    float v = 0.0f;
+    for (uint32_t i = 0; i < FILTER_TRACE_WINDOWS; i++) {
+      v = feedFilter(filter, position, 100, WINDOW_US * 1e-6f);
+    }
+    checkFigure("settled cps", c, 0.1f, 10000.0f, v);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_step_response);
+  RUN_TEST(test_ramp_lag);
+  RUN_TEST(test_noise);
+  RUN_TEST(test_step_settles);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+// Host test of the Q16 blend path (fixedPoint configs) against the float
+// path: both pipelines see the same snapshots of a constant speed trace,
+// from 2 to 2e6 cps, with window lengths that are off nominal (late wakes
+// and a missed window), and must agree to a relative error bound.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include "velocity.h"
+// Out-of-line parts of the pipeline (the sketch sources are not built here)
+#include "velocity.cpp"
+#include "velocity_filter.cpp"
+
+struct FloatConfig {
+  static constexpr uint32_t ppr = 1024;
+  static constexpr uint32_t sampleUs = 10000;
+  static constexpr float emaAlpha = 0.4f;
+  static constexpr uint32_t timeoutUs = 500000;
+  static constexpr VelocityEstimator estimator = VelocityEstimator::AdaptiveBlend;
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 80000000;  // MCPWM capture timer
+  static constexpr float observerTheta = 0.7f;
+  static constexpr bool fixedPoint = false;
+  static constexpr bool accelEstimate = false;
+  static constexpr uint32_t regressionEdges = 16;
+  static constexpr uint32_t regressionSpanUs = 50000;
+};
+
+struct FixedConfig : FloatConfig {
+  static constexpr bool fixedPoint = true;
+};
+
+struct FloatFixedBlendConfig : FloatConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::FixedBlend;
+};
+
+struct FixedFixedBlendConfig : FloatFixedBlendConfig {
+  static constexpr bool fixedPoint = true;
+};
+
+constexpr uint32_t WINDOWS = 400;
+// Window lengths past the nominal 10 ms: late wakes, and every 64th
+// window a missed one
+static const uint32_t LATE_US[8] = {0, 3, 7, 1, 0, 12, 5, 2};
+static const float SPEEDS[] = {2.0f, 20.0f, 200.0f, 2e3f, 2e4f, 2e5f, 2e6f};
+// One Q16 LSB at 2 cps is 7.6e-6
+constexpr double MAX_RELATIVE_ERROR = 1.4e-5;
+
+// Largest |Q16 - float| over the trace, relative to the float estimate
+// (or the true speed while the estimate is still below it)
+template <typename FloatCfg, typename FixedCfg>
+static double maxRelativeError(float cps) {
+  VelocityPipeline<FloatCfg> floatPath;
+  VelocityPipeline<FixedCfg> fixedPath;
+  EncoderSnapshot snap = {};
+  snap.deltaSign = 1;
+  snap.edgeDeltaTicks = (uint32_t)(FloatCfg::edgeTickHz / cps + 0.5f);
+  uint32_t now = 0;
+  double worst = 0.0;
+
+  floatPath.update(snap, now);
+  fixedPath.update(snap, now);
+  for (uint32_t i = 1; i <= WINDOWS; i++) {
+    now += FloatCfg::sampleUs + LATE_US[i & 7];
+    if ((i & 63) == 0) now += FloatCfg::sampleUs;
+    double t = now * 1e-6;
+    int64_t position = (int64_t)floor(cps * t);
+    if (position != snap.position) {
+      snap.position = position;
+      snap.lastEdgeMicros = (uint32_t)(position * 1e6 / cps);
+    }
+    floatPath.update(snap, now);
+    fixedPath.update(snap, now);
+
+    double ref = fabs((double)floatPath.countsPerSec());
+    if (ref < cps) ref = cps;
+    double err = fabs((double)fixedPath.countsPerSec() - (double)floatPath.countsPerSec()) / ref;
+    if (err > worst) worst = err;
+  }
+  return worst;
+}
+
+void setUp() {}
+void tearDown() {}
+
+template <typename FloatCfg, typename FixedCfg>
+static void checkAllSpeeds() {
+  char msg[64];
+  for (float cps : SPEEDS) {
+    double err = maxRelativeError<FloatCfg, FixedCfg>(cps);
+    snprintf(msg, sizeof(msg), "%.0f cps: relative error %.3g", cps, err);
+    TEST_ASSERT_TRUE_MESSAGE(err <= MAX_RELATIVE_ERROR, msg);
+  }
+}
+
+void test_adaptive_blend_q16_matches_float() {
+  checkAllSpeeds<FloatConfig, FixedConfig>();
+}
+
+void test_fixed_blend_q16_matches_float() {
+  checkAllSpeeds<FloatFixedBlendConfig, FixedFixedBlendConfig>();
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_adaptive_blend_q16_matches_float);
+  RUN_TEST(test_fixed_blend_q16_matches_float);
+  return UNITY_END();
+}
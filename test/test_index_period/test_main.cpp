@@ -0,0 +1,90 @@
+// Host test of the Z-to-Z check of the index ISR and of getIndexRPM():
+// clean revolutions both ways, a reversal back over the same Z, distances
+// just inside and just outside the tolerance, and the two-period stop
+// timeout.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "index_check.h"
+
+constexpr uint32_t CPR = 4096;         // 4 * PPR
+constexpr uint32_t TOL = 2;            // INDEX_TOLERANCE_COUNTS
+constexpr uint32_t PERIOD_US = 20000;  // 3000 rpm
+
+void setUp() {}
+void tearDown() {}
+
+static void assertZ(int64_t signedDist, int32_t revError, int32_t periodUs, bool mismatch) {
+  ZToZ z = checkZToZ(signedDist, PERIOD_US, CPR, TOL);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "dist %lld: revError %ld period %ld mismatch %d", (long long)signedDist,
+           (long)z.revError, (long)z.periodUs, (int)z.mismatch);
+  TEST_ASSERT_TRUE_MESSAGE(z.revError == revError, msg);
+  TEST_ASSERT_TRUE_MESSAGE(z.periodUs == periodUs, msg);
+  TEST_ASSERT_TRUE_MESSAGE(z.mismatch == mismatch, msg);
+}
+
+void test_clean_revolution() {
+  assertZ(CPR, 0, PERIOD_US, false);
+  assertZ(-(int64_t)CPR, 0, -(int32_t)PERIOD_US, false);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 3000.0f, indexRpm(PERIOD_US, 0, PERIOD_US));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -3000.0f, indexRpm(-(int32_t)PERIOD_US, 0, PERIOD_US));
+}
+
+void test_reversal_at_same_place() {
+  // Back over the same Z: no revolution, no period, not a mismatch
+  for (int64_t d = -(int64_t)TOL; d <= (int64_t)TOL; d++) {
+    assertZ(d, 0, 0, false);
+  }
+  // One count past the Z pulse width is neither
+  assertZ(TOL + 1, (int32_t)(TOL + 1) - (int32_t)CPR, 0, true);
+  assertZ(-(int64_t)(TOL + 1), (int32_t)(TOL + 1) - (int32_t)CPR, 0, true);
+}
+
+void test_tolerance_edges() {
+  for (int32_t off = -(int32_t)TOL; off <= (int32_t)TOL; off++) {
+    assertZ((int64_t)CPR + off, off, PERIOD_US, false);
+    assertZ(-((int64_t)CPR + off), off, -(int32_t)PERIOD_US, false);
+  }
+  const int32_t out = TOL + 1;
+  assertZ((int64_t)CPR + out, out, 0, true);
+  assertZ((int64_t)CPR - out, -out, 0, true);
+  assertZ(-((int64_t)CPR + out), out, 0, true);
+  assertZ(-((int64_t)CPR - out), -out, 0, true);
+  // Two revolutions between Z pulses (one missed) is a mismatch too
+  assertZ(2 * (int64_t)CPR, CPR, 0, true);
+}
+
+void test_stop_timeout() {
+  const uint32_t latch = 1000;
+  TEST_ASSERT_TRUE(indexRpm(0, latch, latch) == 0.0f);  // No full revolution yet
+  TEST_ASSERT_TRUE(indexRpm(PERIOD_US, latch, latch + 2 * PERIOD_US) != 0.0f);
+  TEST_ASSERT_TRUE(indexRpm(PERIOD_US, latch, latch + 2 * PERIOD_US + 1) == 0.0f);
+  TEST_ASSERT_TRUE(indexRpm(-(int32_t)PERIOD_US, latch, latch + 2 * PERIOD_US) != 0.0f);
+  TEST_ASSERT_TRUE(indexRpm(-(int32_t)PERIOD_US, latch, latch + 2 * PERIOD_US + 1) == 0.0f);
+  // A Z latched just after `now` was sampled is not a stop
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 3000.0f, indexRpm(PERIOD_US, latch, latch - 5));
+}
+
+void test_micros_wrap() {
+  // micros() wraps halfway through the revolution
+  const uint32_t latch = 0xFFFFFFFFu - PERIOD_US / 2;
+  const uint32_t now = latch + PERIOD_US;
+  ZToZ z = checkZToZ(CPR, now - latch, CPR, TOL);
+  TEST_ASSERT_TRUE(z.periodUs == (int32_t)PERIOD_US);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 3000.0f, indexRpm(PERIOD_US, latch, now));
+  TEST_ASSERT_TRUE(indexRpm(PERIOD_US, latch, now + PERIOD_US + 1) == 0.0f);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_revolution);
+  RUN_TEST(test_reversal_at_same_place);
+  RUN_TEST(test_tolerance_edges);
+  RUN_TEST(test_stop_timeout);
+  RUN_TEST(test_micros_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,209 @@
+// Host test of the PCNT seqlock + pending-wrap read (readWrapped() in
+// seqlock.h). A model of the hardware counter, its overflow interrupt and
+// the overflow ISR fires its steps between any two accesses of the reader,
+// for every placement, and the value read must be one the position really
+// held during the read. Also setPosition() over a pending wrap.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdint.h>
+#include <vector>
+#include "seqlock.h"
+
+constexpr int16_t H_LIM = 32767;
+constexpr int16_t L_LIM = -32768;
+
+enum class Step : uint8_t {
+  Count,     // One encoder edge; the counter may wrap and raise int_raw
+  IsrBegin,  // Overflow ISR: seqlock write begin
+  IsrBase,   //   base += limit
+  IsrEnd,    //   seqlock write end
+  IsrClear,  //   int_clr, last (see pcnt_overflow_handler())
+};
+
+// Counter, interrupt and ISR state, plus a schedule of steps to fire
+// before given reader accesses
+struct PcntModel {
+  uint32_t seq = 0;
+  int64_t base = 0;
+  int16_t counter = 0;
+  bool intRaw = false;
+  int16_t wrapLimit = 0;  // Latched event (status_unit)
+  int8_t dir = 1;
+
+  int64_t logical = 0;            // Edges really counted so far
+  std::vector<int64_t> held;      // Every value the position took during the read
+
+  std::vector<Step> steps;
+  std::vector<uint32_t> before;   // steps[i] fires before reader access before[i]
+  size_t next = 0;
+  uint32_t accesses = 0;
+
+  void start(int64_t b, int16_t c, int8_t d) {
+    base = b;
+    counter = c;
+    dir = d;
+    logical = b + c;
+    held.assign(1, logical);
+  }
+
+  void fire(Step s) {
+    switch (s) {
+      case Step::Count:
+        counter += dir;
+        logical += dir;
+        held.push_back(logical);
+        if (counter == H_LIM || counter == L_LIM) {
+          wrapLimit = counter;
+          counter = 0;
+          intRaw = true;
+        }
+        break;
+      case Step::IsrBegin: seq++; break;
+      case Step::IsrBase:  base += wrapLimit; break;
+      case Step::IsrEnd:   seq++; break;
+      case Step::IsrClear: intRaw = false; break;
+    }
+  }
+
+  // Called before every shared access of the reader
+  void access() {
+    while (next < steps.size() && before[next] <= accesses) fire(steps[next++]);
+    accesses++;
+  }
+};
+
+static PcntModel model;
+
+struct ModelLock {
+  uint32_t readBegin() const {
+    uint32_t s;
+    do {
+      model.access();
+      s = model.seq;
+    } while (s & 1);
+    return s;
+  }
+  bool readRetry(uint32_t s) const {
+    model.access();
+    return model.seq != s;
+  }
+};
+
+// Same accesses as EncoderBase::readPCNTPosition()
+static int64_t readPosition(bool checkPending) {
+  int64_t base;
+  int16_t count;
+  readWrapped(ModelLock(), [&] {
+    model.access();
+    base = model.base;
+    model.access();
+    count = model.counter;
+  }, [&] {
+    if (!checkPending) return false;
+    model.access();
+    return model.intRaw;
+  });
+  return base + count;
+}
+
+static bool heldDuringRead(int64_t value) {
+  for (int64_t v : model.held) {
+    if (v == value) return true;
+  }
+  return false;
+}
+
+// Every placement of the steps (in order) before reader accesses 0..maxAccess;
+// returns the number of placements that read a value never held
+static uint32_t runAllPlacements(const std::vector<Step>& steps, int16_t startCount, int8_t dir,
+                                 bool checkPending, uint32_t maxAccess = 12) {
+  uint32_t bad = 0;
+  std::vector<uint32_t> before(steps.size(), 0);
+  for (;;) {
+    model = PcntModel();
+    model.start(1000000, startCount, dir);
+    model.steps = steps;
+    model.before = before;
+    int64_t value = readPosition(checkPending);
+    if (!heldDuringRead(value)) bad++;
+
+    // Next non-decreasing placement
+    size_t i = before.size();
+    while (i > 0 && before[i - 1] == maxAccess) i--;
+    if (i == 0) break;
+    uint32_t v = before[i - 1] + 1;
+    for (size_t j = i - 1; j < before.size(); j++) before[j] = v;
+  }
+  return bad;
+}
+
+static const std::vector<Step> WRAP_AND_ISR = {
+  Step::Count, Step::IsrBegin, Step::IsrBase, Step::IsrEnd, Step::IsrClear,
+};
+
+static const std::vector<Step> WRAP_COUNT_AND_ISR = {
+  Step::Count, Step::Count, Step::IsrBegin, Step::IsrBase, Step::IsrEnd, Step::IsrClear,
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_positive_wrap() {
+  TEST_ASSERT_EQUAL_INT(0, runAllPlacements(WRAP_AND_ISR, H_LIM - 1, 1, true));
+}
+
+void test_negative_wrap() {
+  TEST_ASSERT_EQUAL_INT(0, runAllPlacements(WRAP_AND_ISR, L_LIM + 1, -1, true));
+}
+
+// The counter keeps counting while the overflow interrupt is pending
+void test_counts_during_pending_wrap() {
+  TEST_ASSERT_EQUAL_INT(0, runAllPlacements(WRAP_COUNT_AND_ISR, H_LIM - 1, 1, true));
+  TEST_ASSERT_EQUAL_INT(0, runAllPlacements(WRAP_COUNT_AND_ISR, L_LIM + 1, -1, true));
+}
+
+// The seqlock alone is not enough: between the wrap and the ISR, base and
+// counter belong to different generations. The model must catch that.
+void test_model_catches_missing_pending_check() {
+  TEST_ASSERT_GREATER_THAN(0u, runAllPlacements(WRAP_AND_ISR, H_LIM - 1, 1, false));
+}
+
+// EncoderBase::setPosition(): the counter wrapped and its interrupt is
+// pending when the position is set (interrupts masked), so the ISR runs
+// right after. clearPending is the int_clr in the same critical section.
+static int64_t setPositionOverPendingWrap(int16_t startCount, int8_t dir, bool clearPending) {
+  const int64_t newPos = 500;
+  model = PcntModel();
+  model.start(1000000, startCount, dir);
+  model.fire(Step::Count);  // Wraps, int_raw set
+
+  model.counter = 0;  // pcnt_counter_clear()
+  model.base = newPos;
+  if (clearPending) model.intRaw = false;
+  model.logical = newPos;
+  model.held.assign(1, newPos);
+
+  if (model.intRaw) {  // Interrupts unmasked: the overflow ISR runs
+    for (Step s : {Step::IsrBegin, Step::IsrBase, Step::IsrEnd, Step::IsrClear}) model.fire(s);
+  }
+  return readPosition(true) - newPos;
+}
+
+void test_set_position_discards_pending_wrap() {
+  TEST_ASSERT_EQUAL_INT(0, setPositionOverPendingWrap(H_LIM - 1, 1, true));
+  TEST_ASSERT_EQUAL_INT(0, setPositionOverPendingWrap(L_LIM + 1, -1, true));
+  // Without the int_clr the latched wrap lands on the new base
+  TEST_ASSERT_EQUAL_INT(H_LIM, setPositionOverPendingWrap(H_LIM - 1, 1, false));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_positive_wrap);
+  RUN_TEST(test_negative_wrap);
+  RUN_TEST(test_counts_during_pending_wrap);
+  RUN_TEST(test_model_catches_missing_pending_check);
+  RUN_TEST(test_set_position_discards_pending_wrap);
+  return UNITY_END();
+}
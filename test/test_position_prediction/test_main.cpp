@@ -0,0 +1,86 @@
+// Host test of extrapolatePosition() on the constant acceleration ramp of
+// trace_sim.h (adaptive blend with the acceleration estimate, 80 MHz edge
+// clock, 10 ms windows): RMS position error ahead of, at and before the
+// last edge, against holding the count.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "trace_sim.h"
+// Out-of-line parts of the pipeline (the sketch sources are not built here)
+#include "velocity.cpp"
+#include "velocity_filter.cpp"
+
+struct PredictionConfig {
+  static constexpr uint32_t ppr = 1024;
+  static constexpr uint32_t sampleUs = 10000;
+  static constexpr float emaAlpha = 0.4f;
+  static constexpr uint32_t timeoutUs = 500000;
+  static constexpr VelocityEstimator estimator = VelocityEstimator::AdaptiveBlend;
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 80000000;  // MCPWM capture timer
+  static constexpr float observerTheta = 0.7f;       // OBSERVER_THETA
+  static constexpr bool fixedPoint = false;
+  static constexpr bool accelEstimate = true;
+  static constexpr uint32_t regressionEdges = 16;
+  static constexpr uint32_t regressionSpanUs = 50000;
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void assertRms(const char* what, float rms, float bound) {
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%s rms=%.3f counts, bound %.3f", what, rms, bound);
+  TEST_ASSERT_TRUE_MESSAGE(rms < bound, msg);
+}
+
+// 2 ms ahead at up to 22k cps the held count is hundreds of counts behind;
+// the extrapolation is within a small fraction of one
+void test_extrapolated_ahead() {
+  PredictionFigures fig = runPredictionTrace<PredictionConfig>();
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 252.24f, fig.heldRms);
+  assertRms("extrapolated", fig.predictedRms, 0.05f);
+}
+
+// Between the last edge and the snapshot the bounded query interpolates
+// within the count
+void test_interpolated_now() {
+  PredictionFigures fig = runPredictionTrace<PredictionConfig>();
+  assertRms("interpolated now", fig.nowRms, 0.05f);
+}
+
+// Before the last edge it interpolates back into the previous count rather
+// than clamping to the edge (which would be 0.5 counts off here)
+void test_before_last_edge() {
+  PredictionFigures fig = runPredictionTrace<PredictionConfig>();
+  assertRms("before the last edge", fig.beforeRms, 0.1f);
+}
+
+// A bounded query stays within the count it falls in
+void test_bounded_clamp() {
+  const uint32_t edge = 1000000;
+  // 1000 cps: 1 ms per count
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 100.5, extrapolatePosition(100, edge, 1, 1000.0f, 0.0f, edge + 500, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 100.999, extrapolatePosition(100, edge, 1, 1000.0f, 0.0f, edge + 5000, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 99.5, extrapolatePosition(100, edge, 1, 1000.0f, 0.0f, edge - 500, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 99.0, extrapolatePosition(100, edge, 1, 1000.0f, 0.0f, edge - 5000, true));
+  // Reverse
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 99.5, extrapolatePosition(100, edge, -1, -1000.0f, 0.0f, edge + 500, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 100.5, extrapolatePosition(100, edge, -1, -1000.0f, 0.0f, edge - 500, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 101.0, extrapolatePosition(100, edge, -1, -1000.0f, 0.0f, edge - 5000, true));
+  // Speed against the edge direction (reversed since): stays at the edge
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 100.0, extrapolatePosition(100, edge, 1, -1000.0f, 0.0f, edge + 500, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 100.0, extrapolatePosition(100, edge, 1, -1000.0f, 0.0f, edge - 500, true));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_extrapolated_ahead);
+  RUN_TEST(test_interpolated_now);
+  RUN_TEST(test_before_last_edge);
+  RUN_TEST(test_bounded_clamp);
+  return UNITY_END();
+}
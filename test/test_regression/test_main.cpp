@@ -0,0 +1,190 @@
+// Host test of the sliding sums of EdgeRegression against a brute-force
+// least-squares fit over the same points, as edges enter, leave by the N
+// and LimitTicks bounds, are trimmed, and after a restart (the ring
+// overflow path clears the fit). Ticks wrap through 2^32 on the way.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "regression.h"
+
+constexpr uint32_t N = 16;                  // REGRESSION_EDGES
+constexpr uint32_t LIMIT_TICKS = 40000000;  // 0.5 s of the 80 MHz capture timer
+
+// The points the fit should hold: the same eviction rules, kept plainly
+struct HeldPoints {
+  uint32_t ticks[N];
+  int32_t count[N];
+  uint32_t used = 0;
+
+  void dropOldest() {
+    for (uint32_t i = 1; i < used; i++) {
+      ticks[i - 1] = ticks[i];
+      count[i - 1] = count[i];
+    }
+    used--;
+  }
+  void add(uint32_t t, int32_t c) {
+    while (used > 0 && t - ticks[0] > LIMIT_TICKS) dropOldest();
+    if (used == N) dropOldest();
+    ticks[used] = t;
+    count[used] = c;
+    used++;
+  }
+  void trim(uint32_t span) {
+    while (used > 2 && ticks[used - 1] - ticks[0] > span) dropOldest();
+  }
+  // Textbook slope over the points, in long double relative to the first
+  bool slope(long double& s) const {
+    if (used < 2) return false;
+    long double mt = 0, mx = 0;
+    for (uint32_t i = 0; i < used; i++) {
+      mt += (long double)(uint32_t)(ticks[i] - ticks[0]);
+      mx += (long double)(count[i] - count[0]);
+    }
+    mt /= used;
+    mx /= used;
+    long double stt = 0, stx = 0;
+    for (uint32_t i = 0; i < used; i++) {
+      long double dt = (long double)(uint32_t)(ticks[i] - ticks[0]) - mt;
+      stt += dt * dt;
+      stx += dt * ((long double)(count[i] - count[0]) - mx);
+    }
+    if (stt <= 0) return false;
+    s = stx / stt;
+    return true;
+  }
+};
+
+typedef EdgeRegression<N, LIMIT_TICKS> Fit;
+
+static uint32_t rng = 1;
+static uint32_t nextRandom() {
+  rng = rng * 1103515245u + 12345u;
+  return rng >> 8;
+}
+
+static void assertSameFit(const Fit& fit, const HeldPoints& held, const char* step, uint32_t i) {
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%s %u: size %u, expected %u", step, (unsigned)i,
+           (unsigned)fit.size(), (unsigned)held.used);
+  TEST_ASSERT_TRUE_MESSAGE(fit.size() == held.used, msg);
+  float got = 0.0f;
+  long double want = 0;
+  bool gotOk = fit.slope(got);
+  bool wantOk = held.slope(want);
+  snprintf(msg, sizeof(msg), "%s %u: slope valid %d, expected %d", step, (unsigned)i, (int)gotOk,
+           (int)wantOk);
+  TEST_ASSERT_TRUE_MESSAGE(gotOk == wantOk, msg);
+  if (!wantOk) return;
+  // Exact sums; only the final float division rounds
+  double tol = 1e-5 * fabs((double)want) + 1e-12;
+  snprintf(msg, sizeof(msg), "%s %u: slope %.9g, brute force %.9g", step, (unsigned)i, (double)got,
+           (double)want);
+  TEST_ASSERT_TRUE_MESSAGE(fabs(got - (double)want) <= tol, msg);
+}
+
+// Random edge intervals (1 us .. 2 ms at 80 MHz), mostly forward with
+// some reversals, starting just before the tick counter wraps
+struct EdgeSource {
+  uint32_t ticks = 0xFFFFFFFFu - 2000000u;
+  int32_t count = 1000;
+  void next(uint32_t maxInterval) {
+    ticks += 80 + nextRandom() % maxInterval;
+    count += (nextRandom() % 8 == 0) ? -1 : 1;
+  }
+};
+
+void setUp() { rng = 1; }
+void tearDown() {}
+
+void test_fill_and_slide() {
+  Fit fit;
+  HeldPoints held;
+  EdgeSource src;
+  for (uint32_t i = 0; i < 200; i++) {
+    src.next(160000);
+    fit.add(src.ticks, src.count);
+    held.add(src.ticks, src.count);
+    assertSameFit(fit, held, "add", i);
+  }
+}
+
+// Gaps past LimitTicks drop one or more of the oldest points at once
+void test_limit_ticks() {
+  Fit fit;
+  HeldPoints held;
+  EdgeSource src;
+  for (uint32_t i = 0; i < 300; i++) {
+    src.next((i % 37 == 36) ? LIMIT_TICKS : 8000000);
+    fit.add(src.ticks, src.count);
+    held.add(src.ticks, src.count);
+    assertSameFit(fit, held, "limit", i);
+  }
+}
+
+void test_trim() {
+  Fit fit;
+  HeldPoints held;
+  EdgeSource src;
+  for (uint32_t i = 0; i < 300; i++) {
+    src.next(400000);
+    fit.add(src.ticks, src.count);
+    held.add(src.ticks, src.count);
+    uint32_t span = 200000 + nextRandom() % 4000000;
+    fit.trim(span);
+    held.trim(span);
+    assertSameFit(fit, held, "trim", i);
+  }
+  // Trimming never goes below two points
+  fit.trim(0);
+  held.trim(0);
+  TEST_ASSERT_TRUE(fit.size() == 2);
+  assertSameFit(fit, held, "trim to two", 0);
+}
+
+// The edge ring overflowed: the fit restarts from the next edge and must
+// not remember anything from before
+void test_restart_after_clear() {
+  Fit fit;
+  HeldPoints held;
+  EdgeSource src;
+  for (uint32_t i = 0; i < 400; i++) {
+    if (i % 50 == 49) {
+      fit.clear();
+      held.used = 0;
+      src.count += 12345;  // Edges lost in the overflow
+      src.ticks += 3000000;
+    }
+    src.next(160000);
+    fit.add(src.ticks, src.count);
+    held.add(src.ticks, src.count);
+    assertSameFit(fit, held, "restart", i);
+  }
+}
+
+// A standstill at one timestamp has no slope; neither has a single point
+void test_degenerate() {
+  Fit fit;
+  float s = 0.0f;
+  TEST_ASSERT_FALSE(fit.slope(s));
+  fit.add(1000, 5);
+  TEST_ASSERT_FALSE(fit.slope(s));
+  fit.add(1000, 6);
+  TEST_ASSERT_FALSE(fit.slope(s));
+  fit.add(1800, 7);
+  TEST_ASSERT_TRUE(fit.slope(s));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_and_slide);
+  RUN_TEST(test_limit_ticks);
+  RUN_TEST(test_trim);
+  RUN_TEST(test_restart_after_clear);
+  RUN_TEST(test_degenerate);
+  return UNITY_END();
+}
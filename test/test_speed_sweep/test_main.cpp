@@ -0,0 +1,96 @@
+// Host test of the M/T estimator on the constant speed trace of
+// trace_sim.h (5% quadrature phase error, +-0.5 us jitter) across four
+// decades of speed, 20 to 200k cps, at the MCPWM 80 MHz edge clock. The
+// edges go through an EDGE_RING_SIZE ring, which overflows from 50k cps;
+// M/T reads count and time from the snapshot and must not notice.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "trace_sim.h"
+// Out-of-line parts of the pipeline (the sketch sources are not built here)
+#include "velocity.cpp"
+#include "velocity_filter.cpp"
+
+constexpr uint32_t RING_SIZE = 256;  // EDGE_RING_SIZE
+
+struct SweepMTConfig {
+  static constexpr uint32_t ppr = 1024;
+  static constexpr uint32_t sampleUs = 10000;
+  static constexpr float emaAlpha = 0.4f;
+  static constexpr uint32_t timeoutUs = 500000;
+  static constexpr VelocityEstimator estimator = VelocityEstimator::MT;
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 80000000;  // MCPWM capture timer
+  static constexpr float observerTheta = 0.7f;
+  static constexpr bool fixedPoint = false;
+  static constexpr bool accelEstimate = false;
+  static constexpr uint32_t regressionEdges = 16;
+  static constexpr uint32_t regressionSpanUs = 50000;
+};
+
+struct SweepBlendConfig : SweepMTConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::AdaptiveBlend;
+};
+
+static EdgeRing<RING_SIZE> ring;
+static uint32_t noCycles() { return 0; }
+
+template <typename Cfg>
+static SpeedTraceResult sweep(float cps) {
+  return runSpeedTrace<Cfg>(cps, ring, noCycles);
+}
+
+struct SpeedBound {
+  float cps;
+  float maxRmsPct;
+};
+
+// At 20 cps a 10 ms window holds at most one edge, so each measurement
+// spans a single edge interval and the 5% phase error shows in full (two
+// edges early/late: +-10%). From 200 cps on the span covers many edges and
+// only the jitter over the span is left.
+static const SpeedBound MT_BOUNDS[] = {
+    {20.0f, 11.0f}, {200.0f, 0.01f}, {2000.0f, 0.01f},
+    {20000.0f, 0.01f}, {50000.0f, 0.01f}, {200000.0f, 0.01f},
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_mt_error_bound_at_each_speed() {
+  char msg[64];
+  for (const SpeedBound& b : MT_BOUNDS) {
+    SpeedTraceResult r = sweep<SweepMTConfig>(b.cps);
+    snprintf(msg, sizeof(msg), "%.0f cps: rms %.4f%% > %.4f%%", b.cps, r.rmsPct, b.maxRmsPct);
+    TEST_ASSERT_TRUE_MESSAGE(r.rmsPct <= b.maxRmsPct, msg);
+  }
+}
+
+void test_mt_ignores_ring_overflow() {
+  SpeedTraceResult r = sweep<SweepMTConfig>(200000.0f);
+  TEST_ASSERT_GREATER_THAN(0u, r.dropped);
+  TEST_ASSERT_TRUE(r.rmsPct <= 0.01f);
+}
+
+// The reference M/T replaces: the adaptive blend on the same trace
+void test_mt_beats_blend_above_crawl() {
+  char msg[64];
+  for (const SpeedBound& b : MT_BOUNDS) {
+    if (b.cps < 200.0f) continue;
+    float mt = sweep<SweepMTConfig>(b.cps).rmsPct;
+    float blend = sweep<SweepBlendConfig>(b.cps).rmsPct;
+    snprintf(msg, sizeof(msg), "%.0f cps: M/T %.4f%%, blend %.4f%%", b.cps, mt, blend);
+    TEST_ASSERT_TRUE_MESSAGE(mt * 100.0f < blend, msg);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_mt_error_bound_at_each_speed);
+  RUN_TEST(test_mt_ignores_ring_overflow);
+  RUN_TEST(test_mt_beats_blend_above_crawl);
+  return UNITY_END();
+}
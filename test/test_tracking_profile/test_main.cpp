@@ -0,0 +1,60 @@
+// Host test of the tracking observer against the adaptive blend on the
+// accel/cruise/decel profile of trace_sim.h (serial_test_simulator.py
+// speeds, 80 MHz edge clock, 10 ms windows): ramp lag and cruise noise.
+//
+// Run: pio test -e native
+
+#include <unity.h>
+#include <stdint.h>
+#include "trace_sim.h"
+// Out-of-line parts of the pipeline (the sketch sources are not built here)
+#include "velocity.cpp"
+#include "velocity_filter.cpp"
+
+struct ProfileBlendConfig {
+  static constexpr uint32_t ppr = 1024;
+  static constexpr uint32_t sampleUs = 10000;
+  static constexpr float emaAlpha = 0.4f;
+  static constexpr uint32_t timeoutUs = 500000;
+  static constexpr VelocityEstimator estimator = VelocityEstimator::AdaptiveBlend;
+  static constexpr bool edgeTiming = true;
+  static constexpr uint32_t edgeTickHz = 80000000;  // MCPWM capture timer
+  static constexpr float observerTheta = 0.7f;       // OBSERVER_THETA
+  static constexpr bool fixedPoint = false;
+  static constexpr bool accelEstimate = false;
+  static constexpr uint32_t regressionEdges = 16;
+  static constexpr uint32_t regressionSpanUs = 50000;
+};
+
+struct ProfileTrackingConfig : ProfileBlendConfig {
+  static constexpr VelocityEstimator estimator = VelocityEstimator::Tracking;
+};
+
+void setUp() {}
+void tearDown() {}
+
+// The blend lags by its EMA ((1-a)/a windows = 15 ms) plus the window/edge
+// mix; the observer models acceleration, so only a few ms are left
+void test_ramp_lag() {
+  ProfileFigures blend = runProfileTrace<ProfileBlendConfig>();
+  ProfileFigures tracking = runProfileTrace<ProfileTrackingConfig>();
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 17.85f, blend.lagMs);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 4.02f, tracking.lagMs);
+  TEST_ASSERT_TRUE(tracking.lagMs * 4.0f < blend.lagMs);
+}
+
+// The price: the observer follows the one-count window quantization, the
+// blend leans on the edge timing at cruise
+void test_cruise_noise() {
+  ProfileFigures blend = runProfileTrace<ProfileBlendConfig>();
+  ProfileFigures tracking = runProfileTrace<ProfileTrackingConfig>();
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, 0.053f, blend.noisePct);
+  TEST_ASSERT_FLOAT_WITHIN(0.3f, 2.564f, tracking.noisePct);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_lag);
+  RUN_TEST(test_cruise_noise);
+  return UNITY_END();
+}